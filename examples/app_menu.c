@@ -14,6 +14,12 @@ _assert_json_ok(JsonError err, int line) {
 #define assert_json_ok(err) _assert_json_ok(err, __LINE__)
 
 
+/* sorted by strcmp, indexed by the enum below */
+static const char* const menu_keys[] = { "header", "items" };
+
+enum { MenuKey_header, MenuKey_items };
+
+
 int main(int argc, const char* argv[]) {
     const char* filename = "menu.json";
     if (argc > 1) {
@@ -46,19 +52,23 @@ int main(int argc, const char* argv[]) {
             err = json_reader_open_object(&content, &menu);
             assert_json_ok(err);
 
+            JsonKeyTable menu_table;
+            err = json_key_table_init(&menu_table, menu_keys, sizeof(menu_keys) / sizeof(menu_keys[0]));
+            assert_json_ok(err);
+
             for (;;) {
-                key_size = sizeof(key);
-                err = json_reader_read_object(&menu, &key_size, key, &type);
+                int key_id;
+                err = json_reader_read_object_key(&menu, &menu_table, &key_id, &type);
                 if (err == JsonError_not_found) { break; }
                 assert_json_ok(err);
 
-                if (strcmp(key, "header") == 0) {
+                if (key_id == MenuKey_header) {
                     value_size = sizeof(value);
                     err = json_reader_read_string(&menu, &value_size, value);
                     assert_json_ok(err);
                     printf("menu header: %s\n", value);
                 }
-                else if (strcmp(key, "items") == 0) {
+                else if (key_id == MenuKey_items) {
                     printf("items:\n");
                     err = json_reader_open_array(&menu, &items);
                     assert_json_ok(err);
@@ -94,7 +104,7 @@ int main(int argc, const char* argv[]) {
                     }
                 }
                 else {
-                    fprintf(stderr, "unhandled key: %s\n", key);
+                    fprintf(stderr, "unhandled menu key\n");
                     err = json_reader_consume_value(&menu);
                     assert_json_ok(err);
                 }
@@ -5,7 +5,7 @@
 
 
 static const char _usage[] =
-    "usage: jpp [-i INDENT] [-b BUFSIZE] [<file>]\n"
+    "usage: jpp [-i INDENT] [-b BUFSIZE] [--mmap] [--lines] [<file>]\n"
     ;
 
 
@@ -29,6 +29,8 @@ typedef struct {
     char* buf;
     int nesting;
     int indent_size;
+    int use_mmap;
+    int use_lines;
 } Context;
 
 
@@ -169,16 +171,76 @@ jfilter_value(JSON* jin, JSON* jout, Context* context) {
             fprintf(stderr, "! unhandled value type %d\n", type);
             abort();
     }
+    return err;
+}
+
+
+/* Copies size bytes from the start of scratch to out. */
+static JsonError
+copy_scratch(FILE* scratch, size_t size, FILE* out, Context* context) {
+    rewind(scratch);
+    while (size != 0) {
+        size_t n = size < context->bufsize ? size : context->bufsize;
+        if (fread(context->buf, 1, n, scratch) != n) { return JsonError_read; }
+        if (fwrite(context->buf, 1, n, out) != n) { return JsonError_write; }
+        size -= n;
+    }
+    rewind(scratch);
     return JsonError_ok;
 }
 
 
+/* Prints each record of newline-delimited JSON on its own line,
+   reporting malformed records and carrying on with the next one.
+   A record is written to a scratch file first and copied out only
+   once it has parsed, so a malformed one leaves no partial line. */
+static JsonError
+jfilter_records(JSON* jin, Context* context, const char* filename) {
+    FILE* out = context->file_out;
+    FILE* scratch = tmpfile();
+    if (scratch == NULL) {
+        perror("tmpfile");
+        return JsonError_write;
+    }
+    context->file_out = scratch;
+    JSON jout;
+    JsonError err = json_writer_init(&jout, scratch);
+    JsonRecord record = { 0, 0 };
+    while (err == JsonError_ok) {
+        err = json_reader_next_record(jin, &record);
+        if (err == JsonError_eof) {
+            err = JsonError_ok;
+            break;
+        }
+        if (err == JsonError_ok) {
+            context->nesting = 0;
+            err = jfilter_value(jin, &jout, context);
+        }
+        if (err == JsonError_ok) {
+            fputc('\n', scratch);
+            long size = ftell(scratch);
+            err = size < 0 ? JsonError_write : copy_scratch(scratch, size, out, context);
+        }
+        else {
+            fprintf(stderr, "%s:%zu: json error %d\n", filename, record.line, err);
+            rewind(scratch);
+            err = json_reader_skip_record(jin);
+        }
+    }
+    context->file_out = out;
+    fclose(scratch);
+    return err;
+}
+
+
 
 static int
 parse_args(int argc, const char* argv[], Context* context) {
     context->filename_count = 0;
     context->indent_size = _DefaultIndent;
     context->bufsize = _DefaultBufSize;
+    context->use_mmap = 0;
+    context->use_lines = 0;
 
     int i = 1;
     const char* arg = argv[i];
@@ -213,6 +275,15 @@ parse_args(int argc, const char* argv[], Context* context) {
                     ) {
                         state = 20;
                     }
+                    else if (strcmp(arg, "--mmap") == 0) {
+                        context->use_mmap = 1;
+                    }
+                    else if (
+                        strcmp(arg, "-l") == 0 ||
+                        strcmp(arg, "--lines") == 0
+                    ) {
+                        context->use_lines = 1;
+                    }
                     else {
                         fprintf(stderr, "unknown option: %s", arg);
                         fprintf(stderr, _usage);
@@ -284,9 +355,20 @@ int main(int argc, const char* argv[]) {
 
     for (; fi < context.filename_count; ++fi) {
         filename = context.filenames[fi];
-        FILE* fp;
+        FILE* fp = NULL;
+        JSON jreader, jwriter;
+        JsonError err;
+
         if (strcmp(filename, "-") == 0) {
             fp = stdin;
+            err = json_reader_init(&jreader, fp);
+        }
+        else if (context.use_mmap) {
+            err = json_reader_init_mmap(&jreader, filename);
+            if (err == JsonError_read) {
+                perror(filename);
+                return 1;
+            }
         }
         else {
             fp = fopen(filename, "r");
@@ -294,22 +376,29 @@ int main(int argc, const char* argv[]) {
                 perror(filename);
                 return 1;
             }
+            err = json_reader_init(&jreader, fp);
         }
-
-        JSON jreader, jwriter;
-        JsonError err = json_reader_init(&jreader, fp);
         guard_ok(err);
 
         err = json_writer_init(&jwriter, context.file_out);
         guard_ok(err);
 
-        err = jfilter_value(&jreader, &jwriter, &context);
+        if (context.use_lines) {
+            err = jfilter_records(&jreader, &context, filename);
+        }
+        else {
+            err = jfilter_value(&jreader, &jwriter, &context);
+        }
         guard_ok(err);
 
-        if (fp != stdin) {
+        err = json_reader_close(&jreader);
+        guard_ok(err);
+        if (fp != NULL && fp != stdin) {
             fclose(fp);
         }
-        puts("");
+        if (!context.use_lines) {
+            puts("");
+        }
     }
     return 0;
 }
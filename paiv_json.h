@@ -25,13 +25,30 @@
 #endif
 
 
-#ifndef PAIV_JSON_NUMBER_BACKEND_TYPE
-#define PAIV_JSON_NUMBER_BACKEND_TYPE long long int
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+/* Nesting limit for json_reader_consume_value and json_document_parse;
+   deeper input fails with JsonError_depth. Readers start at this limit
+   and json_reader_set_max_depth lowers it per reader. */
+#ifndef PAIV_JSON_MAX_DEPTH
+#define PAIV_JSON_MAX_DEPTH 1024
 #endif
 
+/* Worker limit for the parallel readers. */
+#ifndef PAIV_JSON_MAX_THREADS
+#define PAIV_JSON_MAX_THREADS 64
+#endif
 
-#include <math.h>
-#include <stdio.h>
+#ifndef PAIV_JSON_POSIX
+#if (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L) || defined(__APPLE__)
+#define PAIV_JSON_POSIX 1
+#else
+#define PAIV_JSON_POSIX 0
+#endif
+#endif
 
 
 #ifdef __cplusplus
@@ -49,6 +66,9 @@ typedef enum {
     JsonError_bufsize,
     JsonError_unicode,
     JsonError_write,
+    JsonError_read,
+    JsonError_range,
+    JsonError_depth,
 } JsonError;
 
 
@@ -63,17 +83,197 @@ typedef enum {
 } JsonValueType;
 
 
+/* Refill callback for json_reader_init_source.
+   Points *data at the next chunk of input and stores its length in *size.
+   The chunk must stay valid until the next call. Return JsonError_eof,
+   or a zero size, at the end of input. */
+typedef JsonError (*JsonReadFunc)(void* user_data, const char** data, size_t* size);
+
+
+/* Flush callback for json_writer_init_buffer.
+   Receives the filled part of the output buffer, or a larger block
+   written past it. Return JsonError_ok when all of it was consumed. */
+typedef JsonError (*JsonFlushFunc)(void* user_data, const char* data, size_t size);
+
+
+/* A string read by json_reader_read_string_view.
+   When borrowed is set, data points into the reader's source bytes and
+   is not NUL-terminated; otherwise it points at the decoded copy in the
+   caller's scratch buffer. A view borrowed from a buffer or mapped
+   reader lasts as long as its data. One borrowed from a source or pipe
+   reader lasts only until the next json_reader_* call on this reader or
+   a reader nested in it: a refill hands the window back to the source,
+   or to the producer thread, which overwrites it. Object keys are
+   borrowed only from buffer and mapped readers. */
+typedef struct {
+    const char* data;
+    size_t size;
+    int borrowed;
+} JsonStringView;
+
+
+/* Expected object keys for json_reader_read_object_key, which reports
+   a key by its index in the table, or -1 when it is not listed.
+   Set up with json_key_table_init from keys sorted by strcmp; the key
+   array must stay valid while the table is used. */
+typedef struct {
+    const char* const* _keys;
+    int _count;
+} JsonKeyTable;
+
+
+/* Entry of the structural index built by json_reader_build_index: the
+   offset of a structural character or opening quote, and for an opening
+   bracket the number of the entry holding its closing bracket. */
+typedef struct {
+    uint32_t _offset;
+    uint32_t _close;
+} JsonIndexEntry;
+
+
 typedef struct {
     FILE* _file;
+    const char* _head;
+    const char* _ptr;
+    const char* _end;
+    JsonReadFunc _read;
+    JsonFlushFunc _flush;
+    void* _user_data;
+    const JsonIndexEntry* _index;
+    size_t _index_count;
+    size_t _index_pos;
+    size_t _offset;
+    size_t _line;
+    size_t _record;
+    size_t _newline;
+    size_t _newlines;
+    int _max_depth;
+    int _flags;
+} JsonStream;
+
+
+/* Reader or writer context. A root context initialized by
+   json_reader_init* or json_writer_init* holds its stream in
+   _stream_data; nested contexts from the open_object and open_array
+   calls only point at the root's stream and leave that member unused.
+   This makes JSON larger than the FILE-only context of earlier
+   versions (152 bytes instead of 24 on LP64), which changes the ABI. */
+typedef struct {
+    JsonStream* _stream;
     int _element_count;
     int _parser_token;
     char _parser_char;
+    JsonStream _stream_data;
 } JSON;
 
 
+/* Paths for json_reader_project, compiled by json_projection_init into
+   caller storage: a trie of reference tokens whose object members are
+   matched through key tables shared by all paths. */
+typedef struct {
+    struct _JsonProjectionNode* _nodes;
+    const char** _keys;
+    int _count;
+} JsonProjection;
+
+
+/* Start of a record found by json_reader_next_record: the byte offset
+   of its value in the input and its 1-based line number. */
+typedef struct {
+    size_t offset;
+    size_t line;
+} JsonRecord;
+
+
+/* A chunk of input handled by one worker of a parallel reader: its
+   number in input order, byte range and record count. line is the
+   chunk's first line number when records are committed in order, and 0
+   otherwise. */
+typedef struct {
+    size_t index;
+    size_t offset;
+    size_t size;
+    size_t line;
+    size_t records;
+} JsonChunk;
+
+
+/* Called on a worker thread with a reader positioned at a record; the
+   record's line number is counted from the start of its chunk. Array
+   elements come with a frame of the array and line 0. */
+typedef JsonError (*JsonRecordFunc)(void* user_data, int worker, JSON* context, const JsonRecord* record);
+
+
+/* Called once a worker has finished a chunk; calls never overlap, and
+   run in input order when requested. */
+typedef JsonError (*JsonChunkFunc)(void* user_data, int worker, const JsonChunk* chunk);
+
+
+/* Setup for json_reader_parallel_records and json_reader_parallel_array.
+   Inputs are split into chunks of about chunk_size bytes; commit may be
+   NULL. */
+typedef struct {
+    JsonRecordFunc record;
+    JsonChunkFunc commit;
+    void* user_data;
+    int threads;
+    int ordered;
+    size_t chunk_size;
+} JsonParallel;
+
+
+/* Receives a value matched by json_reader_project; path is the index
+   of its pointer. The value is next in the stream and must be read or
+   skipped through context before returning JsonError_ok. */
+typedef JsonError (*JsonProjectionFunc)(void* user_data, int path, JSON* context);
+
+
+/* A value stored in a JsonDocument. Nodes are laid out in document
+   order, so the first child of a container follows it directly and
+   each node records the distance to its next sibling. */
+typedef struct {
+    unsigned char _type;
+    unsigned char _flags;
+    uint32_t _size;
+    uint32_t _next;
+    uint32_t _key_size;
+    const char* _key;
+    union {
+        const char* _string;
+        long long _integer;
+        double _real;
+    } _value;
+} JsonNode;
+
+
+/* Parsed values in a single caller-provided arena: nodes grow from the
+   start, strings and interned keys from the end. Nothing is allocated;
+   json_document_reset makes the whole arena available again. */
+typedef struct {
+    JsonNode* _nodes;
+    size_t _node_count;
+    char* _strings;
+    char* _end;
+    const char** _keys;
+    size_t _key_mask;
+    size_t _key_count;
+} JsonDocument;
+
+
 PVJDEF JsonError json_reader_init(JSON* context, FILE* file);
+PVJDEF JsonError json_reader_init_buffer(JSON* context, const char* data, size_t size);
+PVJDEF JsonError json_reader_init_source(JSON* context, JsonReadFunc read, void* user_data);
+PVJDEF JsonError json_reader_init_unlocked(JSON* context, FILE* file);
+PVJDEF JsonError json_reader_init_mmap(JSON* context, const char* path);
+PVJDEF size_t json_reader_pipe_storage_size(size_t buffer_size, int buffers);
+PVJDEF JsonError json_reader_init_pipe(JSON* context, FILE* file, size_t buffer_size, void* storage, size_t storage_size);
+PVJDEF JsonError json_reader_close(JSON* context);
+PVJDEF JsonError json_reader_set_max_depth(JSON* context, int depth);
+PVJDEF JsonError json_reader_build_index(JSON* context, JsonIndexEntry* entries, size_t* count);
 PVJDEF JsonError json_reader_open_object(JSON* context, JSON* object);
 PVJDEF JsonError json_reader_read_object(JSON* context, size_t* key_size, char* key, JsonValueType* value);
+PVJDEF JsonError json_reader_read_object_key(JSON* context, const JsonKeyTable* table, int* key_id, JsonValueType* value);
+PVJDEF JsonError json_reader_read_object_view(JSON* context, JsonStringView* key, size_t scratch_size, char* scratch, JsonValueType* value);
 PVJDEF JsonError json_reader_open_array(JSON* context, JSON* array);
 PVJDEF JsonError json_reader_read_array(JSON* context, JsonValueType* value);
 PVJDEF JsonError json_reader_read_numberi(JSON* context, int* value);
@@ -83,13 +283,46 @@ PVJDEF JsonError json_reader_read_numberf(JSON* context, float* value);
 PVJDEF JsonError json_reader_read_numberd(JSON* context, double* value);
 PVJDEF JsonError json_reader_read_numberld(JSON* context, long double* value);
 PVJDEF JsonError json_reader_read_string(JSON* context, size_t* buf_size, char* buf);
+PVJDEF JsonError json_reader_read_string_view(JSON* context, JsonStringView* view, size_t scratch_size, char* scratch);
 PVJDEF JsonError json_reader_resume_string(JSON* context, size_t* buf_size, char* buf);
 PVJDEF JsonError json_reader_read_bool(JSON* context, int* value);
 PVJDEF JsonError json_reader_read_null(JSON* context);
 PVJDEF JsonError json_reader_consume_value(JSON* context);
+PVJDEF JsonError json_reader_skip_value(JSON* context);
+PVJDEF JsonError json_reader_seek_pointer(JSON* context, const char* pointer);
+PVJDEF JsonError json_reader_next_record(JSON* context, JsonRecord* record);
+PVJDEF JsonError json_reader_skip_record(JSON* context);
+PVJDEF JsonError json_reader_parallel_records(JSON* context, const JsonParallel* parallel);
+PVJDEF JsonError json_reader_parallel_array(JSON* context, const JsonParallel* parallel);
+PVJDEF JsonError json_reader_project(JSON* context, const JsonProjection* projection, JsonProjectionFunc callback, void* user_data);
 PVJDEF JsonError json_reader_peek_value(JSON* context, JsonValueType* value);
 
+PVJDEF JsonError json_key_table_init(JsonKeyTable* table, const char* const* keys, int count);
+
+PVJDEF size_t json_projection_storage_size(const char* const* pointers, int count);
+PVJDEF JsonError json_projection_init(JsonProjection* projection, const char* const* pointers, int count, void* storage, size_t storage_size);
+
+PVJDEF JsonError json_document_init(JsonDocument* document, void* arena, size_t arena_size);
+PVJDEF void json_document_reset(JsonDocument* document);
+PVJDEF size_t json_document_used(const JsonDocument* document);
+PVJDEF JsonError json_document_parse(JsonDocument* document, JSON* context, const JsonNode** root);
+PVJDEF JsonValueType json_node_type(const JsonNode* node);
+PVJDEF size_t json_node_size(const JsonNode* node);
+PVJDEF const JsonNode* json_node_child(const JsonNode* node);
+PVJDEF const JsonNode* json_node_next(const JsonNode* node);
+PVJDEF const JsonNode* json_node_find(const JsonNode* object, const char* key);
+PVJDEF const char* json_node_key(const JsonNode* node, size_t* key_size);
+PVJDEF JsonError json_node_string(const JsonNode* node, const char** value, size_t* size);
+PVJDEF JsonError json_node_numberll(const JsonNode* node, long long* value);
+PVJDEF JsonError json_node_numberd(const JsonNode* node, double* value);
+PVJDEF JsonError json_node_bool(const JsonNode* node, int* value);
+
 PVJDEF JsonError json_writer_init(JSON* context, FILE* file);
+PVJDEF JsonError json_writer_init_unlocked(JSON* context, FILE* file);
+PVJDEF JsonError json_writer_init_buffer(JSON* context, char* buf, size_t buf_size, JsonFlushFunc flush, void* user_data);
+PVJDEF JsonError json_writer_flush(JSON* context);
+PVJDEF size_t json_writer_buffer_size(JSON* context);
+PVJDEF JsonError json_writer_close(JSON* context);
 PVJDEF JsonError json_writer_open_object(JSON* context, JSON* object);
 PVJDEF JsonError json_writer_close_object(JSON* object);
 PVJDEF JsonError json_writer_write_object_key_separator(JSON* object);
@@ -104,8 +337,10 @@ PVJDEF JsonError json_writer_write_numberf(JSON* context, float value);
 PVJDEF JsonError json_writer_write_numberd(JSON* context, double value);
 PVJDEF JsonError json_writer_write_numberld(JSON* context, long double value);
 PVJDEF JsonError json_writer_write_string(JSON* context, const char* value);
+PVJDEF JsonError json_writer_write_stringn(JSON* context, const char* value, size_t size);
 PVJDEF JsonError json_writer_write_bool(JSON* context, int value);
 PVJDEF JsonError json_writer_write_null(JSON* context);
+PVJDEF JsonError json_writer_write_node(JSON* context, const JsonNode* node, int indent);
 
 
 #ifdef __cplusplus
@@ -119,6 +354,31 @@ PVJDEF JsonError json_writer_write_null(JSON* context);
 #ifdef PAIV_JSON_IMPLEMENTATION
 
 
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(PAIV_JSON_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define _PAIV_JSON_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define _PAIV_JSON_X86_SIMD 0
+#endif
+
+#if PAIV_JSON_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
 typedef enum {
     _TokenType_invalid,
     _TokenType_bool_false,
@@ -136,16 +396,344 @@ typedef enum {
 } _TokenType;
 
 
+typedef enum {
+    _JsonStreamFlag_unlocked = 1,
+    _JsonStreamFlag_mapped = 2,
+    _JsonStreamFlag_piped = 4,
+    _JsonStreamFlag_records = 8,
+} _JsonStreamFlag;
+
+
 static void
 _json_parser_init(JSON* state) {
     state->_parser_token = _TokenType_invalid;
 }
 
 
+/* Points state at its own stream over a FILE, a window of data or a
+   read callback, with every position and limit reset. */
+static void
+_json_stream_init(JSON* state, FILE* file, const char* data, size_t size, JsonReadFunc read, JsonFlushFunc flush, void* user_data) {
+    JsonStream* stream = &state->_stream_data;
+    stream->_file = file;
+    stream->_head = data;
+    stream->_ptr = data;
+    stream->_end = data != NULL ? data + size : NULL;
+    stream->_read = read;
+    stream->_flush = flush;
+    stream->_user_data = user_data;
+    stream->_index = NULL;
+    stream->_index_count = 0;
+    stream->_index_pos = 0;
+    stream->_offset = 0;
+    stream->_line = 0;
+    stream->_record = 0;
+    stream->_newline = 0;
+    stream->_newlines = 0;
+    stream->_max_depth = PAIV_JSON_MAX_DEPTH;
+    stream->_flags = 0;
+    state->_stream = stream;
+    state->_element_count = 0;
+    _json_parser_init(state);
+}
+
+
+/* Notes the newlines of the current record in the window up to end:
+   where the first one ends and how many there are, for
+   json_reader_skip_record once the window has been refilled. */
+static void
+_json_stream_count_newlines(JsonStream* stream, const char* end) {
+    const char* p = stream->_head;
+    if (stream->_record > stream->_offset) {
+        p += stream->_record - stream->_offset;
+    }
+    while (p < end) {
+        const char* q = (const char*) memchr(p, '\n', end - p);
+        if (q == NULL) { break; }
+        if (stream->_newline <= stream->_record) {
+            stream->_newline = stream->_offset + (q - stream->_head) + 1;
+        }
+        stream->_newlines++;
+        p = q + 1;
+    }
+}
+
+
+static int
+_json_stream_underflow(JsonStream* stream) {
+    if (stream->_file != NULL) {
+#if PAIV_JSON_POSIX
+        int c = (stream->_flags & _JsonStreamFlag_unlocked) ? getc_unlocked(stream->_file) : fgetc(stream->_file);
+#else
+        int c = fgetc(stream->_file);
+#endif
+        stream->_offset += c != EOF;
+        if (c == '\n' && stream->_newline <= stream->_record) {
+            stream->_newline = stream->_offset;
+        }
+        return c;
+    }
+    if (stream->_read != NULL) {
+        if ((stream->_flags & _JsonStreamFlag_records) && stream->_head != NULL) {
+            _json_stream_count_newlines(stream, stream->_end);
+        }
+        const char* data;
+        size_t size = 0;
+        JsonError err = stream->_read(stream->_user_data, &data, &size);
+        if (err == JsonError_ok && size != 0) {
+            stream->_offset += stream->_end - stream->_head;
+            stream->_head = data;
+            stream->_ptr = data + 1;
+            stream->_end = data + size;
+            return (unsigned char) data[0];
+        }
+    }
+    return EOF;
+}
+
+
+static int
+_json_stream_getc(JsonStream* stream) {
+    if (stream->_ptr != stream->_end) {
+        return (unsigned char) *stream->_ptr++;
+    }
+    return _json_stream_underflow(stream);
+}
+
+
+static void
+_json_stream_ungetc(JsonStream* stream, int c) {
+    if (c == EOF) {
+        return;
+    }
+    if (stream->_file != NULL) {
+        ungetc(c, stream->_file);
+        stream->_offset--;
+        if (c == '\n' && stream->_newline > stream->_offset) {
+            stream->_newline = 0;
+        }
+    }
+    else {
+        stream->_ptr--;
+    }
+}
+
+
+/* Character classes of a 64-byte block, one bit per byte. */
+typedef struct {
+    uint64_t quotes;
+    uint64_t backslashes;
+    uint64_t opens;
+    uint64_t closes;
+    uint64_t separators;
+} _JsonBlockMasks;
+
+
+#if _PAIV_JSON_X86_SIMD
+
+static int
+_json_cpu_has_avx2(void) {
+    static int has_avx2 = -1;
+    if (has_avx2 < 0) {
+        has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return has_avx2;
+}
+
+
+static const char*
+_json_scan_string_sse2(const char* p, const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) p);
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(x, control), control));
+        int mask = _mm_movemask_epi8(m);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return p;
+}
+
+
+static const char*
+_json_skip_whitespace_sse2(const char* p, const char* end) {
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i tab = _mm_set1_epi8(0x09);
+    const __m128i lf = _mm_set1_epi8(0x0A);
+    const __m128i cr = _mm_set1_epi8(0x0D);
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) p);
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)));
+        int mask = _mm_movemask_epi8(m) ^ 0xFFFF;
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return p;
+}
+
+
+/* Advances over 16-byte blocks of a container body, updating *depth,
+   and stops at the first quote or at a block where depth could end. */
+static const char*
+_json_skip_brackets_sse2(const char* p, const char* end, int* depth) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    int d = *depth;
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) p);
+        /* maps '[' to '{' and ']' to '}' */
+        __m128i y = _mm_or_si128(x, lower);
+        unsigned int q = _mm_movemask_epi8(_mm_cmpeq_epi8(x, quote));
+        unsigned int limit = q != 0 ? (q & -q) - 1 : 0xFFFF;
+        unsigned int opens = _mm_movemask_epi8(_mm_cmpeq_epi8(y, open)) & limit;
+        unsigned int closes = _mm_movemask_epi8(_mm_cmpeq_epi8(y, close)) & limit;
+        int nclose = __builtin_popcount(closes);
+        if (nclose >= d) {
+            break;
+        }
+        d += __builtin_popcount(opens) - nclose;
+        if (q != 0) {
+            p += __builtin_ctz(q);
+            break;
+        }
+    }
+    *depth = d;
+    return p;
+}
+
+
+/* Builds bit masks of quotes, backslashes, brackets and separators
+   for a 64-byte block. */
+static void
+_json_index_masks_sse2(const char* p, _JsonBlockMasks* masks) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    uint64_t q = 0, b = 0, o = 0, c = 0, s = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i x = _mm_loadu_si128((const __m128i*) (p + 16 * i));
+        /* maps '[' to '{' and ']' to '}' */
+        __m128i y = _mm_or_si128(x, lower);
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, colon), _mm_cmpeq_epi8(x, comma));
+        q |= (uint64_t) (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(x, quote)) << (16 * i);
+        b |= (uint64_t) (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(x, backslash)) << (16 * i);
+        o |= (uint64_t) (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(y, open)) << (16 * i);
+        c |= (uint64_t) (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(y, close)) << (16 * i);
+        s |= (uint64_t) (unsigned int) _mm_movemask_epi8(m) << (16 * i);
+    }
+    masks->quotes = q;
+    masks->backslashes = b;
+    masks->opens = o;
+    masks->closes = c;
+    masks->separators = s;
+}
+
+
+__attribute__((target("avx2")))
+static const char*
+_json_scan_string_avx2(const char* p, const char* end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*) p);
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(x, control), control));
+        unsigned int mask = _mm256_movemask_epi8(m);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return p;
+}
+
+#endif
+
+
+static int
+_json_is_whitespace(unsigned char c) {
+    return c == 0x20 || c == 0x0A || c == 0x0D || c == 0x09;
+}
+
+
+/* Returns the first non-whitespace byte in [p, end), or end. */
+static const char*
+_json_skip_whitespace(const char* p, const char* end) {
+    if (p == end || !_json_is_whitespace(*p)) {
+        return p;
+    }
+#if _PAIV_JSON_X86_SIMD
+    p = _json_skip_whitespace_sse2(p, end);
+#else
+    for (; end - p >= 8; p += 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        if (x != 0x2020202020202020ull) {
+            break;
+        }
+    }
+#endif
+    for (; p != end; ++p) {
+        if (!_json_is_whitespace(*p)) {
+            break;
+        }
+    }
+    return p;
+}
+
+
+/* Returns the first quote, backslash or control byte in [p, end), or end. */
+static const char*
+_json_scan_string(const char* p, const char* end) {
+#if _PAIV_JSON_X86_SIMD
+    if (_json_cpu_has_avx2()) {
+        p = _json_scan_string_avx2(p, end);
+    }
+    p = _json_scan_string_sse2(p, end);
+#else
+    for (; end - p >= 8; p += 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        const uint64_t ones = 0x0101010101010101ull;
+        const uint64_t highs = 0x8080808080808080ull;
+        uint64_t q = x ^ (ones * '"');
+        uint64_t b = x ^ (ones * '\\');
+        uint64_t m = ((q - ones) & ~q) | ((b - ones) & ~b) | ((x - ones * 0x20) & ~x);
+        if ((m & highs) != 0) {
+            break;
+        }
+    }
+#endif
+    for (; p != end; ++p) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\' || c < 0x20) {
+            break;
+        }
+    }
+    return p;
+}
+
+
 static JsonError
-_json_parser_read_token(JSON* state, FILE* fp, _TokenType* token) {
+_json_parser_read_token(JSON* state, JsonStream* stream, _TokenType* token) {
     for (;;) {
-        int c = fgetc(fp);
+        stream->_ptr = _json_skip_whitespace(stream->_ptr, stream->_end);
+        int c = _json_stream_getc(stream);
         switch (c) {
             case 0x09:
             case 0x0A:
@@ -185,28 +773,28 @@ _json_parser_read_token(JSON* state, FILE* fp, _TokenType* token) {
                         break;
                     case 't':
                         if (
-                            fgetc(fp) == 'r' &&
-                            fgetc(fp) == 'u' &&
-                            fgetc(fp) == 'e'
+                            _json_stream_getc(stream) == 'r' &&
+                            _json_stream_getc(stream) == 'u' &&
+                            _json_stream_getc(stream) == 'e'
                             ) {
                             t = _TokenType_bool_true;
                         }
                         break;
                     case 'f':
                         if (
-                            fgetc(fp) == 'a' &&
-                            fgetc(fp) == 'l' &&
-                            fgetc(fp) == 's' &&
-                            fgetc(fp) == 'e'
+                            _json_stream_getc(stream) == 'a' &&
+                            _json_stream_getc(stream) == 'l' &&
+                            _json_stream_getc(stream) == 's' &&
+                            _json_stream_getc(stream) == 'e'
                             ) {
                             t = _TokenType_bool_false;
                         }
                         break;
                     case 'n':
                         if (
-                            fgetc(fp) == 'u' &&
-                            fgetc(fp) == 'l' &&
-                            fgetc(fp) == 'l'
+                            _json_stream_getc(stream) == 'u' &&
+                            _json_stream_getc(stream) == 'l' &&
+                            _json_stream_getc(stream) == 'l'
                             ) {
                             t = _TokenType_null_value;
                         }
@@ -225,9 +813,10 @@ _json_parser_read_token(JSON* state, FILE* fp, _TokenType* token) {
 
 
 static JsonError
-_json_parser_peek_token(JSON* state, FILE* fp, _TokenType* token) {
+_json_parser_peek_token(JSON* state, JsonStream* stream, _TokenType* token) {
     for (;;) {
-        int c = fgetc(fp);
+        stream->_ptr = _json_skip_whitespace(stream->_ptr, stream->_end);
+        int c = _json_stream_getc(stream);
         switch (c) {
             case 0x09:
             case 0x0A:
@@ -237,7 +826,7 @@ _json_parser_peek_token(JSON* state, FILE* fp, _TokenType* token) {
             case EOF:
                 return JsonError_eof;
             default: {
-                ungetc(c, fp);
+                _json_stream_ungetc(stream, c);
                 _TokenType t = _TokenType_invalid;
                 switch (c) {
                     case '{':
@@ -285,13 +874,34 @@ _json_parser_peek_token(JSON* state, FILE* fp, _TokenType* token) {
 }
 
 
+/* Copies the run of plain string bytes at the stream window into buf,
+   leaving room for the terminator. */
+static size_t
+_json_stream_copy_string(JsonStream* stream, char* buf, size_t room) {
+    const char* p = stream->_ptr;
+    const char* end = stream->_end;
+    if ((size_t) (end - p) > room) {
+        end = p + room;
+    }
+    size_t n = _json_scan_string(p, end) - p;
+    memcpy(buf, p, n);
+    stream->_ptr += n;
+    return n;
+}
+
+
 static JsonError
-_json_parser_read_string(JSON* _, FILE* fp, size_t* buf_size, char* buf) {
+_json_parser_read_string(JSON* _, JsonStream* stream, size_t* buf_size, char* buf) {
     size_t capacity = *buf_size;
     size_t count = 0;
     int state = 0;
     for (;;) {
-        int c = fgetc(fp);
+        if (state == 0 && stream->_ptr != stream->_end && count + 1 < capacity) {
+            size_t n = _json_stream_copy_string(stream, buf, capacity - count - 1);
+            buf += n;
+            count += n;
+        }
+        int c = _json_stream_getc(stream);
         if (c == EOF) {
             return JsonError_eof;
         }
@@ -305,13 +915,20 @@ _json_parser_read_string(JSON* _, FILE* fp, size_t* buf_size, char* buf) {
                             return JsonError_ok;
                         }
                         else {
-                            ungetc(c, fp);
+                            _json_stream_ungetc(stream, c);
                             *buf_size = count;
                             return JsonError_bufsize;
                         }
                         break;
                     case '\\':
-                        state = 1;
+                        if (count + 1 < capacity) {
+                            state = 1;
+                        }
+                        else {
+                            _json_stream_ungetc(stream, c);
+                            *buf_size = count;
+                            return JsonError_bufsize;
+                        }
                         break;
                     case 0x00 ... 0x1F:
                         return JsonError_invalid;
@@ -324,7 +941,7 @@ _json_parser_read_string(JSON* _, FILE* fp, size_t* buf_size, char* buf) {
                             count++;
                         }
                         else {
-                            ungetc(c, fp);
+                            _json_stream_ungetc(stream, c);
                             *buf_size = count;
                             return JsonError_bufsize;
                         }
@@ -361,16 +978,9 @@ _json_parser_read_string(JSON* _, FILE* fp, size_t* buf_size, char* buf) {
                         default:
                             return JsonError_invalid;
                     }
-                    if (count + 1 < capacity) {
-                        *buf++ = c;
-                        count++;
-                        state = 0;
-                    }
-                    else {
-                        fseek(fp, -2, SEEK_CUR);
-                        *buf_size = count;
-                        return JsonError_bufsize;
-                    }
+                    *buf++ = c;
+                    count++;
+                    state = 0;
                 }
                 break;
             case 2: {
@@ -378,7 +988,7 @@ _json_parser_read_string(JSON* _, FILE* fp, size_t* buf_size, char* buf) {
                 size_t i;
                 for (i = 0; i < 4; ++i) {
                     if (i != 0) {
-                        c = fgetc(fp);
+                        c = _json_stream_getc(stream);
                     }
                     if (c == EOF) {
                         return JsonError_eof;
@@ -416,16 +1026,9 @@ _json_parser_read_string(JSON* _, FILE* fp, size_t* buf_size, char* buf) {
                     return JsonError_unicode;
                 }
                 c = value & 0xFF;
-                if (count + 1 < capacity) {
-                    *buf++ = c;
-                    count++;
-                    state = 0;
-                }
-                else {
-                    fseek(fp, -6, SEEK_CUR);
-                    *buf_size = count;
-                    return JsonError_bufsize;
-                }
+                *buf++ = c;
+                count++;
+                state = 0;
                 }
                 break;
         }
@@ -433,11 +1036,36 @@ _json_parser_read_string(JSON* _, FILE* fp, size_t* buf_size, char* buf) {
 }
 
 
+/* Borrows the string from the stream window when it ends there without
+   escapes and borrow is set; otherwise decodes it into scratch. */
+static JsonError
+_json_parser_read_string_view(JSON* state, JsonStream* stream, JsonStringView* view, size_t scratch_size, char* scratch, int borrow) {
+    const char* p = stream->_ptr;
+    const char* q = _json_scan_string(p, stream->_end);
+    if (borrow && q != stream->_end && *q == '"') {
+        stream->_ptr = q + 1;
+        view->data = p;
+        view->size = q - p;
+        view->borrowed = 1;
+        return JsonError_ok;
+    }
+    size_t size = scratch_size;
+    JsonError err = _json_parser_read_string(state, stream, &size, scratch);
+    view->data = scratch;
+    view->size = size;
+    view->borrowed = 0;
+    return err;
+}
+
+
 static JsonError
-_json_parser_consume_string(JSON* _, FILE* fp) {
+_json_parser_consume_string(JSON* _, JsonStream* stream) {
     int state = 0;
     for (;;) {
-        int c = fgetc(fp);
+        if (state == 0) {
+            stream->_ptr = _json_scan_string(stream->_ptr, stream->_end);
+        }
+        int c = _json_stream_getc(stream);
         if (c == EOF) {
             return JsonError_eof;
         }
@@ -495,7 +1123,7 @@ _json_parser_consume_string(JSON* _, FILE* fp) {
                 size_t i;
                 for (i = 0; i < 4; ++i) {
                     if (i != 0) {
-                        c = fgetc(fp);
+                        c = _json_stream_getc(stream);
                     }
                     if (c == EOF) {
                         return JsonError_eof;
@@ -517,149 +1145,393 @@ _json_parser_consume_string(JSON* _, FILE* fp) {
 }
 
 
+/* Skips to the closing quote without validating escapes or bytes. */
 static JsonError
-_json_parser_read_number(JSON* context, FILE* fp, PAIV_JSON_NUMBER_BACKEND_TYPE* value, PAIV_JSON_NUMBER_BACKEND_TYPE* exponent) {
-    PAIV_JSON_NUMBER_BACKEND_TYPE x = 0;
-    PAIV_JSON_NUMBER_BACKEND_TYPE y = 0;
-    int sign = 1;
-    int msign = 1;
-    int decs = 0;
-    int state = 0;
-    char c;
-    if (context->_parser_token == _TokenType_number) {
-        c = context->_parser_char;
-        context->_parser_token = _TokenType_invalid;
-    }
-    else {
-        c = fgetc(fp);
-    }
-    for (;; c = fgetc(fp)) {
-        switch (state) {
-            case 0:
-                switch (c) {
-                    case '-':
-                        sign = -1;
-                        state = 1;
-                        break;
-                    case '0':
-                        state = 3;
-                        break;
-                    case '1' ... '9':
-                        switch (c) {
-                            case '1': x = 1; break;
-                            case '2': x = 2; break;
-                            case '3': x = 3; break;
-                            case '4': x = 4; break;
-                            case '5': x = 5; break;
-                            case '6': x = 6; break;
-                            case '7': x = 7; break;
-                            case '8': x = 8; break;
-                            case '9': x = 9; break;
-                        }
-                        state = 2;
-                        break;
-                    case EOF:
-                        return JsonError_eof;
-                    default:
-                        return JsonError_invalid;
-                }
-                break;
-            case 1:
-                switch (c) {
-                    case '0':
-                        state = 3;
-                        break;
-                    case '1' ... '9':
-                        switch (c) {
-                            case '1': x = 1; break;
-                            case '2': x = 2; break;
-                            case '3': x = 3; break;
-                            case '4': x = 4; break;
-                            case '5': x = 5; break;
-                            case '6': x = 6; break;
-                            case '7': x = 7; break;
-                            case '8': x = 8; break;
-                            case '9': x = 9; break;
-                        }
-                        state = 2;
-                        break;
-                    case EOF:
-                        return JsonError_eof;
-                    default:
-                        return JsonError_invalid;
+_json_parser_skip_string(JsonStream* stream) {
+    for (;;) {
+        stream->_ptr = _json_scan_string(stream->_ptr, stream->_end);
+        int c = _json_stream_getc(stream);
+        switch (c) {
+            case EOF:
+                return JsonError_eof;
+            case '"':
+                return JsonError_ok;
+            case '\\':
+                if (_json_stream_getc(stream) == EOF) {
+                    return JsonError_eof;
                 }
                 break;
-            case 2:
-                switch (c) {
-                    case '0' ... '9':
-                        switch (c) {
-                            case '0': x = x * 10 + 0; break;
-                            case '1': x = x * 10 + 1; break;
-                            case '2': x = x * 10 + 2; break;
-                            case '3': x = x * 10 + 3; break;
-                            case '4': x = x * 10 + 4; break;
-                            case '5': x = x * 10 + 5; break;
-                            case '6': x = x * 10 + 6; break;
-                            case '7': x = x * 10 + 7; break;
-                            case '8': x = x * 10 + 8; break;
-                            case '9': x = x * 10 + 9; break;
-                        }
-                        break;
-                    case '.':
-                        state = 5;
-                        break;
-                    case 'e':
-                    case 'E':
-                        state = 7;
-                        break;
-                    case EOF:
-                        *value = x * sign;
-                        *exponent = 0;
-                        return JsonError_ok;
-                    default:
-                        ungetc(c, fp);
-                        *value = x * sign;
-                        *exponent = 0;
-                        return JsonError_ok;
-                }
+            default:
                 break;
-            case 3:
-                switch (c) {
-                    case '.':
-                        state = 5;
+        }
+    }
+}
+
+
+static void
+_json_index_masks(const char* p, _JsonBlockMasks* masks) {
+#if _PAIV_JSON_X86_SIMD
+    _json_index_masks_sse2(p, masks);
+#else
+    uint64_t q = 0, b = 0, o = 0, c = 0, s = 0;
+    for (int i = 0; i < 64; ++i) {
+        uint64_t bit = (uint64_t) 1 << i;
+        switch (p[i]) {
+            case '"':
+                q |= bit;
+                break;
+            case '\\':
+                b |= bit;
+                break;
+            case '[':
+            case '{':
+                o |= bit;
+                break;
+            case ']':
+            case '}':
+                c |= bit;
+                break;
+            case ':':
+            case ',':
+                s |= bit;
+                break;
+            default:
+                break;
+        }
+    }
+    masks->quotes = q;
+    masks->backslashes = b;
+    masks->opens = o;
+    masks->closes = c;
+    masks->separators = s;
+#endif
+}
+
+
+/* Sets each bit to the xor of itself and all lower bits. */
+static uint64_t
+_json_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+
+/* Marks characters escaped by a backslash; odd-length backslash runs
+   escape the next character. *carry holds an escape pending from the
+   previous block. */
+static uint64_t
+_json_index_escaped(uint64_t backslashes, uint64_t* carry) {
+    const uint64_t even = 0x5555555555555555ull;
+    backslashes &= ~*carry;
+    uint64_t follows = (backslashes << 1) | *carry;
+    uint64_t odd_starts = backslashes & ~even & ~follows;
+    uint64_t even_runs;
+    *carry = __builtin_add_overflow(odd_starts, backslashes, &even_runs);
+    return (even ^ (even_runs << 1)) & follows;
+}
+
+
+/* Finds the first index entry at or after offset pos, starting from
+   the cursor left by the previous lookup. */
+static size_t
+_json_index_lower_bound(const JsonStream* stream, uint32_t pos) {
+    const JsonIndexEntry* entries = stream->_index;
+    size_t lo = 0;
+    size_t hi = stream->_index_count;
+    size_t hint = stream->_index_pos;
+    if (hint < hi) {
+        if (entries[hint]._offset < pos) {
+            lo = hint + 1;
+        }
+        else {
+            hi = hint;
+        }
+    }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entries[mid]._offset < pos) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+
+/* Index counterpart of _json_parser_skip_container. Right after the
+   opening bracket it jumps straight to the matching close; from inside
+   a container it walks the remaining entries of that level, jumping
+   over nested containers. */
+static JsonError
+_json_index_skip_container(JsonStream* stream) {
+    const JsonIndexEntry* entries = stream->_index;
+    size_t count = stream->_index_count;
+    size_t pos = stream->_ptr - stream->_head;
+    size_t i = _json_index_lower_bound(stream, pos == 0 ? 0 : (uint32_t) (pos - 1));
+    int depth = 1;
+    if (i < count && entries[i]._offset + 1 == pos) {
+        char c = stream->_head[entries[i]._offset];
+        if ((c == '[' || c == '{') && entries[i]._close != 0) {
+            i = entries[i]._close;
+            depth = 0;
+        }
+        ++i;
+    }
+    for (; depth != 0; ++i) {
+        if (i == count) {
+            stream->_ptr = stream->_end;
+            stream->_index_pos = count;
+            return JsonError_eof;
+        }
+        switch (stream->_head[entries[i]._offset]) {
+            case '[':
+            case '{':
+                if (entries[i]._close != 0) {
+                    i = entries[i]._close;
+                }
+                else {
+                    depth++;
+                }
+                break;
+            case ']':
+            case '}':
+                depth--;
+                break;
+            default:
+                break;
+        }
+    }
+    stream->_ptr = stream->_head + entries[i - 1]._offset + 1;
+    stream->_index_pos = i;
+    return JsonError_ok;
+}
+
+
+/* Skips the rest of an array or object after its opening bracket,
+   tracking only string boundaries and bracket depth. */
+static JsonError
+_json_parser_skip_container(JsonStream* stream) {
+    if (stream->_index != NULL) {
+        return _json_index_skip_container(stream);
+    }
+    int depth = 1;
+    for (;;) {
+#if _PAIV_JSON_X86_SIMD
+        stream->_ptr = _json_skip_brackets_sse2(stream->_ptr, stream->_end, &depth);
+#endif
+        int c = _json_stream_getc(stream);
+        switch (c) {
+            case EOF:
+                return JsonError_eof;
+            case '"': {
+                JsonError err = _json_parser_skip_string(stream);
+                if (err != JsonError_ok) {
+                    return err;
+                }
+                }
+                break;
+            case '[':
+            case '{':
+                depth++;
+                break;
+            case ']':
+            case '}':
+                if (--depth == 0) {
+                    return JsonError_ok;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+
+typedef struct {
+    unsigned char digits[800];
+    int count;
+    int point;
+    int negative;
+    int truncated;
+} _JsonDecimal;
+
+
+typedef struct {
+    uint64_t mantissa;
+    int mantissa_digits;
+    int digits;
+    int point;
+    int exponent;
+    int negative;
+    int truncated;
+    _JsonDecimal* decimal;
+} _JsonNumber;
+
+
+static void
+_json_number_push_digit(_JsonNumber* number, int x) {
+    if (number->mantissa_digits < 19) {
+        number->mantissa = number->mantissa * 10 + x;
+        number->mantissa_digits++;
+    }
+    else if (x != 0) {
+        number->truncated = 1;
+    }
+    _JsonDecimal* decimal = number->decimal;
+    if (decimal != NULL) {
+        if (decimal->count < (int) sizeof(decimal->digits)) {
+            decimal->digits[decimal->count++] = x;
+        }
+        else if (x != 0) {
+            decimal->truncated = 1;
+        }
+    }
+    number->digits++;
+}
+
+
+/* Loads 8 bytes with the first byte in the low bits. */
+static uint64_t
+_json_load_le64(const char* p) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+
+static int
+_json_is_eight_digits(uint64_t x) {
+    const uint64_t highs = 0xF0F0F0F0F0F0F0F0ull;
+    return ((x & highs) | (((x + 0x0606060606060606ull) & highs) >> 4)) == 0x3333333333333333ull;
+}
+
+
+/* Converts 8 ASCII digits to their value with three multiplications. */
+static uint32_t
+_json_parse_eight_digits(uint64_t x) {
+    const uint64_t mask = 0x000000FF000000FFull;
+    const uint64_t mul1 = 100 + (1000000ull << 32);
+    const uint64_t mul2 = 1 + (10000ull << 32);
+    x -= 0x3030303030303030ull;
+    x = x * 10 + (x >> 8);
+    x = ((x & mask) * mul1 + ((x >> 16) & mask) * mul2) >> 32;
+    return (uint32_t) x;
+}
+
+
+/* Consumes runs of eight digits directly from a buffered window. */
+static void
+_json_number_push_digits(_JsonNumber* number, JsonStream* stream) {
+    while (stream->_end - stream->_ptr >= 8) {
+        const char* p = stream->_ptr;
+        uint64_t x = _json_load_le64(p);
+        if (!_json_is_eight_digits(x)) {
+            break;
+        }
+        _JsonDecimal* decimal = number->decimal;
+        if (number->mantissa_digits > 19 - 8
+            || (decimal != NULL && decimal->count > (int) sizeof(decimal->digits) - 8)) {
+            for (int i = 0; i < 8; ++i) {
+                _json_number_push_digit(number, p[i] - '0');
+            }
+        }
+        else {
+            number->mantissa = number->mantissa * 100000000 + _json_parse_eight_digits(x);
+            number->mantissa_digits += 8;
+            number->digits += 8;
+            if (decimal != NULL) {
+                uint64_t values;
+                memcpy(&values, p, 8);
+                values -= 0x3030303030303030ull;
+                memcpy(decimal->digits + decimal->count, &values, 8);
+                decimal->count += 8;
+            }
+        }
+        stream->_ptr = p + 8;
+    }
+}
+
+
+static JsonError
+_json_number_finish(_JsonNumber* number, int exponent) {
+    number->point += exponent;
+    number->exponent = number->mantissa != 0 ? number->point - number->mantissa_digits : 0;
+    _JsonDecimal* decimal = number->decimal;
+    if (decimal != NULL) {
+        decimal->point = number->point;
+        decimal->negative = number->negative;
+    }
+    return JsonError_ok;
+}
+
+
+/* Scans a number into a mantissa of up to 19 significant digits and a
+   power of ten. When number->decimal is set, all digits are kept there
+   too, for the exact conversion path. */
+static JsonError
+_json_parser_read_number(JSON* context, JsonStream* stream, _JsonNumber* number) {
+    int y = 0;
+    int msign = 1;
+    int state = 0;
+    int c;
+    number->mantissa = 0;
+    number->mantissa_digits = 0;
+    number->digits = 0;
+    number->point = 0;
+    number->negative = 0;
+    number->truncated = 0;
+    if (number->decimal != NULL) {
+        number->decimal->count = 0;
+        number->decimal->truncated = 0;
+    }
+    if (context->_parser_token == _TokenType_number) {
+        c = context->_parser_char;
+        context->_parser_token = _TokenType_invalid;
+    }
+    else {
+        c = _json_stream_getc(stream);
+    }
+    for (;; c = _json_stream_getc(stream)) {
+        switch (state) {
+            case 0:
+                switch (c) {
+                    case '-':
+                        number->negative = 1;
+                        state = 1;
                         break;
-                    case 'E':
-                    case 'e':
-                        state = 7;
+                    case '0':
+                        state = 3;
+                        break;
+                    case '1' ... '9':
+                        _json_number_push_digit(number, c - '0');
+                        _json_number_push_digits(number, stream);
+                        state = 2;
                         break;
                     case EOF:
-                        *value = x * sign;
-                        *exponent = 0;
-                        return JsonError_ok;
+                        return JsonError_eof;
                     default:
-                        ungetc(c, fp);
-                        *value = x * sign;
-                        *exponent = 0;
-                        return JsonError_ok;
+                        return JsonError_invalid;
                 }
                 break;
-            case 5:
+            case 1:
                 switch (c) {
-                    case '0' ... '9':
-                        decs++;
-                        switch (c) {
-                            case '0': x = x * 10 + 0; break;
-                            case '1': x = x * 10 + 1; break;
-                            case '2': x = x * 10 + 2; break;
-                            case '3': x = x * 10 + 3; break;
-                            case '4': x = x * 10 + 4; break;
-                            case '5': x = x * 10 + 5; break;
-                            case '6': x = x * 10 + 6; break;
-                            case '7': x = x * 10 + 7; break;
-                            case '8': x = x * 10 + 8; break;
-                            case '9': x = x * 10 + 9; break;
-                        }
-                        state = 6;
+                    case '0':
+                        state = 3;
+                        break;
+                    case '1' ... '9':
+                        _json_number_push_digit(number, c - '0');
+                        _json_number_push_digits(number, stream);
+                        state = 2;
                         break;
                     case EOF:
                         return JsonError_eof;
@@ -667,36 +1539,66 @@ _json_parser_read_number(JSON* context, FILE* fp, PAIV_JSON_NUMBER_BACKEND_TYPE*
                         return JsonError_invalid;
                 }
                 break;
+            case 2:
+                switch (c) {
+                    case '0' ... '9':
+                        _json_number_push_digit(number, c - '0');
+                        _json_number_push_digits(number, stream);
+                        break;
+                    case '.':
+                        number->point = number->digits;
+                        state = 5;
+                        break;
+                    case 'e':
+                    case 'E':
+                        number->point = number->digits;
+                        state = 7;
+                        break;
+                    default:
+                        _json_stream_ungetc(stream, c);
+                        number->point = number->digits;
+                        return _json_number_finish(number, 0);
+                }
+                break;
+            case 3:
+                switch (c) {
+                    case '.':
+                        state = 5;
+                        break;
+                    case 'E':
+                    case 'e':
+                        state = 7;
+                        break;
+                    default:
+                        _json_stream_ungetc(stream, c);
+                        return _json_number_finish(number, 0);
+                }
+                break;
+            case 5:
             case 6:
                 switch (c) {
                     case '0' ... '9':
-                        decs++;
-                        switch (c) {
-                            case '0': x = x * 10 + 0; break;
-                            case '1': x = x * 10 + 1; break;
-                            case '2': x = x * 10 + 2; break;
-                            case '3': x = x * 10 + 3; break;
-                            case '4': x = x * 10 + 4; break;
-                            case '5': x = x * 10 + 5; break;
-                            case '6': x = x * 10 + 6; break;
-                            case '7': x = x * 10 + 7; break;
-                            case '8': x = x * 10 + 8; break;
-                            case '9': x = x * 10 + 9; break;
+                        if (c == '0' && number->digits == 0) {
+                            number->point--;
+                        }
+                        else {
+                            _json_number_push_digit(number, c - '0');
+                            _json_number_push_digits(number, stream);
                         }
+                        state = 6;
                         break;
                     case 'E':
                     case 'e':
+                        if (state == 5) { return JsonError_invalid; }
                         state = 7;
                         break;
                     case EOF:
-                        *value = x * sign;
-                        *exponent = -decs;
-                        return JsonError_ok;
+                        if (state == 5) { return JsonError_eof; }
+                        return _json_number_finish(number, 0);
                     default:
-                        ungetc(c, fp);
-                        *value = x * sign;
-                        *exponent = -decs;
-                        return JsonError_ok;
+                        if (state == 5) { return JsonError_invalid; }
+                        _json_stream_ungetc(stream, c);
+                        return _json_number_finish(number, 0);
                 }
                 break;
             case 7:
@@ -706,23 +1608,11 @@ _json_parser_read_number(JSON* context, FILE* fp, PAIV_JSON_NUMBER_BACKEND_TYPE*
                         state = 8;
                         break;
                     case '+':
-                        msign = 1;
                         state = 8;
                         break;
                     case '0' ... '9':
-                        switch (c) {
-                            case '0': y = 0; break;
-                            case '1': y = 1; break;
-                            case '2': y = 2; break;
-                            case '3': y = 3; break;
-                            case '4': y = 4; break;
-                            case '5': y = 5; break;
-                            case '6': y = 6; break;
-                            case '7': y = 7; break;
-                            case '8': y = 8; break;
-                            case '9': y = 9; break;
-                        }
-                        state = 8;
+                        y = c - '0';
+                        state = 9;
                         break;
                     case EOF:
                         return JsonError_eof;
@@ -732,25 +1622,26 @@ _json_parser_read_number(JSON* context, FILE* fp, PAIV_JSON_NUMBER_BACKEND_TYPE*
                 break;
             case 8:
                 switch (c) {
-                    case '0': y = y * 10 + 0; break;
-                    case '1': y = y * 10 + 1; break;
-                    case '2': y = y * 10 + 2; break;
-                    case '3': y = y * 10 + 3; break;
-                    case '4': y = y * 10 + 4; break;
-                    case '5': y = y * 10 + 5; break;
-                    case '6': y = y * 10 + 6; break;
-                    case '7': y = y * 10 + 7; break;
-                    case '8': y = y * 10 + 8; break;
-                    case '9': y = y * 10 + 9; break;
+                    case '0' ... '9':
+                        y = c - '0';
+                        state = 9;
+                        break;
                     case EOF:
-                        *value = x * sign;
-                        *exponent = y * msign - decs;
-                        return JsonError_ok;
+                        return JsonError_eof;
                     default:
-                        ungetc(c, fp);
-                        *value = x * sign;
-                        *exponent = y * msign - decs;
-                        return JsonError_ok;
+                        return JsonError_invalid;
+                }
+                break;
+            case 9:
+                switch (c) {
+                    case '0' ... '9':
+                        if (y < 10000) {
+                            y = y * 10 + (c - '0');
+                        }
+                        break;
+                    default:
+                        _json_stream_ungetc(stream, c);
+                        return _json_number_finish(number, y * msign);
                 }
                 break;
         }
@@ -758,55 +1649,1637 @@ _json_parser_read_number(JSON* context, FILE* fp, PAIV_JSON_NUMBER_BACKEND_TYPE*
 }
 
 
-PVJDEF JsonError
-json_reader_init(JSON* state, FILE* file) {
-    state->_file = file;
-    state->_element_count = 0;
-    _json_parser_init(state);
-    return JsonError_ok;
-}
+/* 128-bit significands of 10^q for q in [-348, 347], normalized so the
+   top bit is set; {high, low} words. */
+#define _JSON_POW10_MIN (-348)
+#define _JSON_POW10_MAX 347
+
+static const uint64_t _json_pow10_table[696][2] = {
+    { 0xFA8FD5A0081C0288, 0x1732C869CD60E453 },
+    { 0x9C99E58405118195, 0x0E7FBD42205C8EB4 },
+    { 0xC3C05EE50655E1FA, 0x521FAC92A873B261 },
+    { 0xF4B0769E47EB5A78, 0xE6A797B752909EF9 },
+    { 0x98EE4A22ECF3188B, 0x9028BED2939A635C },
+    { 0xBF29DCABA82FDEAE, 0x7432EE873880FC33 },
+    { 0xEEF453D6923BD65A, 0x113FAA2906A13B3F },
+    { 0x9558B4661B6565F8, 0x4AC7CA59A424C507 },
+    { 0xBAAEE17FA23EBF76, 0x5D79BCF00D2DF649 },
+    { 0xE95A99DF8ACE6F53, 0xF4D82C2C107973DC },
+    { 0x91D8A02BB6C10594, 0x79071B9B8A4BE869 },
+    { 0xB64EC836A47146F9, 0x9748E2826CDEE284 },
+    { 0xE3E27A444D8D98B7, 0xFD1B1B2308169B25 },
+    { 0x8E6D8C6AB0787F72, 0xFE30F0F5E50E20F7 },
+    { 0xB208EF855C969F4F, 0xBDBD2D335E51A935 },
+    { 0xDE8B2B66B3BC4723, 0xAD2C788035E61382 },
+    { 0x8B16FB203055AC76, 0x4C3BCB5021AFCC31 },
+    { 0xADDCB9E83C6B1793, 0xDF4ABE242A1BBF3D },
+    { 0xD953E8624B85DD78, 0xD71D6DAD34A2AF0D },
+    { 0x87D4713D6F33AA6B, 0x8672648C40E5AD68 },
+    { 0xA9C98D8CCB009506, 0x680EFDAF511F18C2 },
+    { 0xD43BF0EFFDC0BA48, 0x0212BD1B2566DEF2 },
+    { 0x84A57695FE98746D, 0x014BB630F7604B57 },
+    { 0xA5CED43B7E3E9188, 0x419EA3BD35385E2D },
+    { 0xCF42894A5DCE35EA, 0x52064CAC828675B9 },
+    { 0x818995CE7AA0E1B2, 0x7343EFEBD1940993 },
+    { 0xA1EBFB4219491A1F, 0x1014EBE6C5F90BF8 },
+    { 0xCA66FA129F9B60A6, 0xD41A26E077774EF6 },
+    { 0xFD00B897478238D0, 0x8920B098955522B4 },
+    { 0x9E20735E8CB16382, 0x55B46E5F5D5535B0 },
+    { 0xC5A890362FDDBC62, 0xEB2189F734AA831D },
+    { 0xF712B443BBD52B7B, 0xA5E9EC7501D523E4 },
+    { 0x9A6BB0AA55653B2D, 0x47B233C92125366E },
+    { 0xC1069CD4EABE89F8, 0x999EC0BB696E840A },
+    { 0xF148440A256E2C76, 0xC00670EA43CA250D },
+    { 0x96CD2A865764DBCA, 0x380406926A5E5728 },
+    { 0xBC807527ED3E12BC, 0xC605083704F5ECF2 },
+    { 0xEBA09271E88D976B, 0xF7864A44C633682E },
+    { 0x93445B8731587EA3, 0x7AB3EE6AFBE0211D },
+    { 0xB8157268FDAE9E4C, 0x5960EA05BAD82964 },
+    { 0xE61ACF033D1A45DF, 0x6FB92487298E33BD },
+    { 0x8FD0C16206306BAB, 0xA5D3B6D479F8E056 },
+    { 0xB3C4F1BA87BC8696, 0x8F48A4899877186C },
+    { 0xE0B62E2929ABA83C, 0x331ACDABFE94DE87 },
+    { 0x8C71DCD9BA0B4925, 0x9FF0C08B7F1D0B14 },
+    { 0xAF8E5410288E1B6F, 0x07ECF0AE5EE44DD9 },
+    { 0xDB71E91432B1A24A, 0xC9E82CD9F69D6150 },
+    { 0x892731AC9FAF056E, 0xBE311C083A225CD2 },
+    { 0xAB70FE17C79AC6CA, 0x6DBD630A48AAF406 },
+    { 0xD64D3D9DB981787D, 0x092CBBCCDAD5B108 },
+    { 0x85F0468293F0EB4E, 0x25BBF56008C58EA5 },
+    { 0xA76C582338ED2621, 0xAF2AF2B80AF6F24E },
+    { 0xD1476E2C07286FAA, 0x1AF5AF660DB4AEE1 },
+    { 0x82CCA4DB847945CA, 0x50D98D9FC890ED4D },
+    { 0xA37FCE126597973C, 0xE50FF107BAB528A0 },
+    { 0xCC5FC196FEFD7D0C, 0x1E53ED49A96272C8 },
+    { 0xFF77B1FCBEBCDC4F, 0x25E8E89C13BB0F7A },
+    { 0x9FAACF3DF73609B1, 0x77B191618C54E9AC },
+    { 0xC795830D75038C1D, 0xD59DF5B9EF6A2417 },
+    { 0xF97AE3D0D2446F25, 0x4B0573286B44AD1D },
+    { 0x9BECCE62836AC577, 0x4EE367F9430AEC32 },
+    { 0xC2E801FB244576D5, 0x229C41F793CDA73F },
+    { 0xF3A20279ED56D48A, 0x6B43527578C1110F },
+    { 0x9845418C345644D6, 0x830A13896B78AAA9 },
+    { 0xBE5691EF416BD60C, 0x23CC986BC656D553 },
+    { 0xEDEC366B11C6CB8F, 0x2CBFBE86B7EC8AA8 },
+    { 0x94B3A202EB1C3F39, 0x7BF7D71432F3D6A9 },
+    { 0xB9E08A83A5E34F07, 0xDAF5CCD93FB0CC53 },
+    { 0xE858AD248F5C22C9, 0xD1B3400F8F9CFF68 },
+    { 0x91376C36D99995BE, 0x23100809B9C21FA1 },
+    { 0xB58547448FFFFB2D, 0xABD40A0C2832A78A },
+    { 0xE2E69915B3FFF9F9, 0x16C90C8F323F516C },
+    { 0x8DD01FAD907FFC3B, 0xAE3DA7D97F6792E3 },
+    { 0xB1442798F49FFB4A, 0x99CD11CFDF41779C },
+    { 0xDD95317F31C7FA1D, 0x40405643D711D583 },
+    { 0x8A7D3EEF7F1CFC52, 0x482835EA666B2572 },
+    { 0xAD1C8EAB5EE43B66, 0xDA3243650005EECF },
+    { 0xD863B256369D4A40, 0x90BED43E40076A82 },
+    { 0x873E4F75E2224E68, 0x5A7744A6E804A291 },
+    { 0xA90DE3535AAAE202, 0x711515D0A205CB36 },
+    { 0xD3515C2831559A83, 0x0D5A5B44CA873E03 },
+    { 0x8412D9991ED58091, 0xE858790AFE9486C2 },
+    { 0xA5178FFF668AE0B6, 0x626E974DBE39A872 },
+    { 0xCE5D73FF402D98E3, 0xFB0A3D212DC8128F },
+    { 0x80FA687F881C7F8E, 0x7CE66634BC9D0B99 },
+    { 0xA139029F6A239F72, 0x1C1FFFC1EBC44E80 },
+    { 0xC987434744AC874E, 0xA327FFB266B56220 },
+    { 0xFBE9141915D7A922, 0x4BF1FF9F0062BAA8 },
+    { 0x9D71AC8FADA6C9B5, 0x6F773FC3603DB4A9 },
+    { 0xC4CE17B399107C22, 0xCB550FB4384D21D3 },
+    { 0xF6019DA07F549B2B, 0x7E2A53A146606A48 },
+    { 0x99C102844F94E0FB, 0x2EDA7444CBFC426D },
+    { 0xC0314325637A1939, 0xFA911155FEFB5308 },
+    { 0xF03D93EEBC589F88, 0x793555AB7EBA27CA },
+    { 0x96267C7535B763B5, 0x4BC1558B2F3458DE },
+    { 0xBBB01B9283253CA2, 0x9EB1AAEDFB016F16 },
+    { 0xEA9C227723EE8BCB, 0x465E15A979C1CADC },
+    { 0x92A1958A7675175F, 0x0BFACD89EC191EC9 },
+    { 0xB749FAED14125D36, 0xCEF980EC671F667B },
+    { 0xE51C79A85916F484, 0x82B7E12780E7401A },
+    { 0x8F31CC0937AE58D2, 0xD1B2ECB8B0908810 },
+    { 0xB2FE3F0B8599EF07, 0x861FA7E6DCB4AA15 },
+    { 0xDFBDCECE67006AC9, 0x67A791E093E1D49A },
+    { 0x8BD6A141006042BD, 0xE0C8BB2C5C6D24E0 },
+    { 0xAECC49914078536D, 0x58FAE9F773886E18 },
+    { 0xDA7F5BF590966848, 0xAF39A475506A899E },
+    { 0x888F99797A5E012D, 0x6D8406C952429603 },
+    { 0xAAB37FD7D8F58178, 0xC8E5087BA6D33B83 },
+    { 0xD5605FCDCF32E1D6, 0xFB1E4A9A90880A64 },
+    { 0x855C3BE0A17FCD26, 0x5CF2EEA09A55067F },
+    { 0xA6B34AD8C9DFC06F, 0xF42FAA48C0EA481E },
+    { 0xD0601D8EFC57B08B, 0xF13B94DAF124DA26 },
+    { 0x823C12795DB6CE57, 0x76C53D08D6B70858 },
+    { 0xA2CB1717B52481ED, 0x54768C4B0C64CA6E },
+    { 0xCB7DDCDDA26DA268, 0xA9942F5DCF7DFD09 },
+    { 0xFE5D54150B090B02, 0xD3F93B35435D7C4C },
+    { 0x9EFA548D26E5A6E1, 0xC47BC5014A1A6DAF },
+    { 0xC6B8E9B0709F109A, 0x359AB6419CA1091B },
+    { 0xF867241C8CC6D4C0, 0xC30163D203C94B62 },
+    { 0x9B407691D7FC44F8, 0x79E0DE63425DCF1D },
+    { 0xC21094364DFB5636, 0x985915FC12F542E4 },
+    { 0xF294B943E17A2BC4, 0x3E6F5B7B17B2939D },
+    { 0x979CF3CA6CEC5B5A, 0xA705992CEECF9C42 },
+    { 0xBD8430BD08277231, 0x50C6FF782A838353 },
+    { 0xECE53CEC4A314EBD, 0xA4F8BF5635246428 },
+    { 0x940F4613AE5ED136, 0x871B7795E136BE99 },
+    { 0xB913179899F68584, 0x28E2557B59846E3F },
+    { 0xE757DD7EC07426E5, 0x331AEADA2FE589CF },
+    { 0x9096EA6F3848984F, 0x3FF0D2C85DEF7621 },
+    { 0xB4BCA50B065ABE63, 0x0FED077A756B53A9 },
+    { 0xE1EBCE4DC7F16DFB, 0xD3E8495912C62894 },
+    { 0x8D3360F09CF6E4BD, 0x64712DD7ABBBD95C },
+    { 0xB080392CC4349DEC, 0xBD8D794D96AACFB3 },
+    { 0xDCA04777F541C567, 0xECF0D7A0FC5583A0 },
+    { 0x89E42CAAF9491B60, 0xF41686C49DB57244 },
+    { 0xAC5D37D5B79B6239, 0x311C2875C522CED5 },
+    { 0xD77485CB25823AC7, 0x7D633293366B828B },
+    { 0x86A8D39EF77164BC, 0xAE5DFF9C02033197 },
+    { 0xA8530886B54DBDEB, 0xD9F57F830283FDFC },
+    { 0xD267CAA862A12D66, 0xD072DF63C324FD7B },
+    { 0x8380DEA93DA4BC60, 0x4247CB9E59F71E6D },
+    { 0xA46116538D0DEB78, 0x52D9BE85F074E608 },
+    { 0xCD795BE870516656, 0x67902E276C921F8B },
+    { 0x806BD9714632DFF6, 0x00BA1CD8A3DB53B6 },
+    { 0xA086CFCD97BF97F3, 0x80E8A40ECCD228A4 },
+    { 0xC8A883C0FDAF7DF0, 0x6122CD128006B2CD },
+    { 0xFAD2A4B13D1B5D6C, 0x796B805720085F81 },
+    { 0x9CC3A6EEC6311A63, 0xCBE3303674053BB0 },
+    { 0xC3F490AA77BD60FC, 0xBEDBFC4411068A9C },
+    { 0xF4F1B4D515ACB93B, 0xEE92FB5515482D44 },
+    { 0x991711052D8BF3C5, 0x751BDD152D4D1C4A },
+    { 0xBF5CD54678EEF0B6, 0xD262D45A78A0635D },
+    { 0xEF340A98172AACE4, 0x86FB897116C87C34 },
+    { 0x9580869F0E7AAC0E, 0xD45D35E6AE3D4DA0 },
+    { 0xBAE0A846D2195712, 0x8974836059CCA109 },
+    { 0xE998D258869FACD7, 0x2BD1A438703FC94B },
+    { 0x91FF83775423CC06, 0x7B6306A34627DDCF },
+    { 0xB67F6455292CBF08, 0x1A3BC84C17B1D542 },
+    { 0xE41F3D6A7377EECA, 0x20CABA5F1D9E4A93 },
+    { 0x8E938662882AF53E, 0x547EB47B7282EE9C },
+    { 0xB23867FB2A35B28D, 0xE99E619A4F23AA43 },
+    { 0xDEC681F9F4C31F31, 0x6405FA00E2EC94D4 },
+    { 0x8B3C113C38F9F37E, 0xDE83BC408DD3DD04 },
+    { 0xAE0B158B4738705E, 0x9624AB50B148D445 },
+    { 0xD98DDAEE19068C76, 0x3BADD624DD9B0957 },
+    { 0x87F8A8D4CFA417C9, 0xE54CA5D70A80E5D6 },
+    { 0xA9F6D30A038D1DBC, 0x5E9FCF4CCD211F4C },
+    { 0xD47487CC8470652B, 0x7647C3200069671F },
+    { 0x84C8D4DFD2C63F3B, 0x29ECD9F40041E073 },
+    { 0xA5FB0A17C777CF09, 0xF468107100525890 },
+    { 0xCF79CC9DB955C2CC, 0x7182148D4066EEB4 },
+    { 0x81AC1FE293D599BF, 0xC6F14CD848405530 },
+    { 0xA21727DB38CB002F, 0xB8ADA00E5A506A7C },
+    { 0xCA9CF1D206FDC03B, 0xA6D90811F0E4851C },
+    { 0xFD442E4688BD304A, 0x908F4A166D1DA663 },
+    { 0x9E4A9CEC15763E2E, 0x9A598E4E043287FE },
+    { 0xC5DD44271AD3CDBA, 0x40EFF1E1853F29FD },
+    { 0xF7549530E188C128, 0xD12BEE59E68EF47C },
+    { 0x9A94DD3E8CF578B9, 0x82BB74F8301958CE },
+    { 0xC13A148E3032D6E7, 0xE36A52363C1FAF01 },
+    { 0xF18899B1BC3F8CA1, 0xDC44E6C3CB279AC1 },
+    { 0x96F5600F15A7B7E5, 0x29AB103A5EF8C0B9 },
+    { 0xBCB2B812DB11A5DE, 0x7415D448F6B6F0E7 },
+    { 0xEBDF661791D60F56, 0x111B495B3464AD21 },
+    { 0x936B9FCEBB25C995, 0xCAB10DD900BEEC34 },
+    { 0xB84687C269EF3BFB, 0x3D5D514F40EEA742 },
+    { 0xE65829B3046B0AFA, 0x0CB4A5A3112A5112 },
+    { 0x8FF71A0FE2C2E6DC, 0x47F0E785EABA72AB },
+    { 0xB3F4E093DB73A093, 0x59ED216765690F56 },
+    { 0xE0F218B8D25088B8, 0x306869C13EC3532C },
+    { 0x8C974F7383725573, 0x1E414218C73A13FB },
+    { 0xAFBD2350644EEACF, 0xE5D1929EF90898FA },
+    { 0xDBAC6C247D62A583, 0xDF45F746B74ABF39 },
+    { 0x894BC396CE5DA772, 0x6B8BBA8C328EB783 },
+    { 0xAB9EB47C81F5114F, 0x066EA92F3F326564 },
+    { 0xD686619BA27255A2, 0xC80A537B0EFEFEBD },
+    { 0x8613FD0145877585, 0xBD06742CE95F5F36 },
+    { 0xA798FC4196E952E7, 0x2C48113823B73704 },
+    { 0xD17F3B51FCA3A7A0, 0xF75A15862CA504C5 },
+    { 0x82EF85133DE648C4, 0x9A984D73DBE722FB },
+    { 0xA3AB66580D5FDAF5, 0xC13E60D0D2E0EBBA },
+    { 0xCC963FEE10B7D1B3, 0x318DF905079926A8 },
+    { 0xFFBBCFE994E5C61F, 0xFDF17746497F7052 },
+    { 0x9FD561F1FD0F9BD3, 0xFEB6EA8BEDEFA633 },
+    { 0xC7CABA6E7C5382C8, 0xFE64A52EE96B8FC0 },
+    { 0xF9BD690A1B68637B, 0x3DFDCE7AA3C673B0 },
+    { 0x9C1661A651213E2D, 0x06BEA10CA65C084E },
+    { 0xC31BFA0FE5698DB8, 0x486E494FCFF30A62 },
+    { 0xF3E2F893DEC3F126, 0x5A89DBA3C3EFCCFA },
+    { 0x986DDB5C6B3A76B7, 0xF89629465A75E01C },
+    { 0xBE89523386091465, 0xF6BBB397F1135823 },
+    { 0xEE2BA6C0678B597F, 0x746AA07DED582E2C },
+    { 0x94DB483840B717EF, 0xA8C2A44EB4571CDC },
+    { 0xBA121A4650E4DDEB, 0x92F34D62616CE413 },
+    { 0xE896A0D7E51E1566, 0x77B020BAF9C81D17 },
+    { 0x915E2486EF32CD60, 0x0ACE1474DC1D122E },
+    { 0xB5B5ADA8AAFF80B8, 0x0D819992132456BA },
+    { 0xE3231912D5BF60E6, 0x10E1FFF697ED6C69 },
+    { 0x8DF5EFABC5979C8F, 0xCA8D3FFA1EF463C1 },
+    { 0xB1736B96B6FD83B3, 0xBD308FF8A6B17CB2 },
+    { 0xDDD0467C64BCE4A0, 0xAC7CB3F6D05DDBDE },
+    { 0x8AA22C0DBEF60EE4, 0x6BCDF07A423AA96B },
+    { 0xAD4AB7112EB3929D, 0x86C16C98D2C953C6 },
+    { 0xD89D64D57A607744, 0xE871C7BF077BA8B7 },
+    { 0x87625F056C7C4A8B, 0x11471CD764AD4972 },
+    { 0xA93AF6C6C79B5D2D, 0xD598E40D3DD89BCF },
+    { 0xD389B47879823479, 0x4AFF1D108D4EC2C3 },
+    { 0x843610CB4BF160CB, 0xCEDF722A585139BA },
+    { 0xA54394FE1EEDB8FE, 0xC2974EB4EE658828 },
+    { 0xCE947A3DA6A9273E, 0x733D226229FEEA32 },
+    { 0x811CCC668829B887, 0x0806357D5A3F525F },
+    { 0xA163FF802A3426A8, 0xCA07C2DCB0CF26F7 },
+    { 0xC9BCFF6034C13052, 0xFC89B393DD02F0B5 },
+    { 0xFC2C3F3841F17C67, 0xBBAC2078D443ACE2 },
+    { 0x9D9BA7832936EDC0, 0xD54B944B84AA4C0D },
+    { 0xC5029163F384A931, 0x0A9E795E65D4DF11 },
+    { 0xF64335BCF065D37D, 0x4D4617B5FF4A16D5 },
+    { 0x99EA0196163FA42E, 0x504BCED1BF8E4E45 },
+    { 0xC06481FB9BCF8D39, 0xE45EC2862F71E1D6 },
+    { 0xF07DA27A82C37088, 0x5D767327BB4E5A4C },
+    { 0x964E858C91BA2655, 0x3A6A07F8D510F86F },
+    { 0xBBE226EFB628AFEA, 0x890489F70A55368B },
+    { 0xEADAB0ABA3B2DBE5, 0x2B45AC74CCEA842E },
+    { 0x92C8AE6B464FC96F, 0x3B0B8BC90012929D },
+    { 0xB77ADA0617E3BBCB, 0x09CE6EBB40173744 },
+    { 0xE55990879DDCAABD, 0xCC420A6A101D0515 },
+    { 0x8F57FA54C2A9EAB6, 0x9FA946824A12232D },
+    { 0xB32DF8E9F3546564, 0x47939822DC96ABF9 },
+    { 0xDFF9772470297EBD, 0x59787E2B93BC56F7 },
+    { 0x8BFBEA76C619EF36, 0x57EB4EDB3C55B65A },
+    { 0xAEFAE51477A06B03, 0xEDE622920B6B23F1 },
+    { 0xDAB99E59958885C4, 0xE95FAB368E45ECED },
+    { 0x88B402F7FD75539B, 0x11DBCB0218EBB414 },
+    { 0xAAE103B5FCD2A881, 0xD652BDC29F26A119 },
+    { 0xD59944A37C0752A2, 0x4BE76D3346F0495F },
+    { 0x857FCAE62D8493A5, 0x6F70A4400C562DDB },
+    { 0xA6DFBD9FB8E5B88E, 0xCB4CCD500F6BB952 },
+    { 0xD097AD07A71F26B2, 0x7E2000A41346A7A7 },
+    { 0x825ECC24C873782F, 0x8ED400668C0C28C8 },
+    { 0xA2F67F2DFA90563B, 0x728900802F0F32FA },
+    { 0xCBB41EF979346BCA, 0x4F2B40A03AD2FFB9 },
+    { 0xFEA126B7D78186BC, 0xE2F610C84987BFA8 },
+    { 0x9F24B832E6B0F436, 0x0DD9CA7D2DF4D7C9 },
+    { 0xC6EDE63FA05D3143, 0x91503D1C79720DBB },
+    { 0xF8A95FCF88747D94, 0x75A44C6397CE912A },
+    { 0x9B69DBE1B548CE7C, 0xC986AFBE3EE11ABA },
+    { 0xC24452DA229B021B, 0xFBE85BADCE996168 },
+    { 0xF2D56790AB41C2A2, 0xFAE27299423FB9C3 },
+    { 0x97C560BA6B0919A5, 0xDCCD879FC967D41A },
+    { 0xBDB6B8E905CB600F, 0x5400E987BBC1C920 },
+    { 0xED246723473E3813, 0x290123E9AAB23B68 },
+    { 0x9436C0760C86E30B, 0xF9A0B6720AAF6521 },
+    { 0xB94470938FA89BCE, 0xF808E40E8D5B3E69 },
+    { 0xE7958CB87392C2C2, 0xB60B1D1230B20E04 },
+    { 0x90BD77F3483BB9B9, 0xB1C6F22B5E6F48C2 },
+    { 0xB4ECD5F01A4AA828, 0x1E38AEB6360B1AF3 },
+    { 0xE2280B6C20DD5232, 0x25C6DA63C38DE1B0 },
+    { 0x8D590723948A535F, 0x579C487E5A38AD0E },
+    { 0xB0AF48EC79ACE837, 0x2D835A9DF0C6D851 },
+    { 0xDCDB1B2798182244, 0xF8E431456CF88E65 },
+    { 0x8A08F0F8BF0F156B, 0x1B8E9ECB641B58FF },
+    { 0xAC8B2D36EED2DAC5, 0xE272467E3D222F3F },
+    { 0xD7ADF884AA879177, 0x5B0ED81DCC6ABB0F },
+    { 0x86CCBB52EA94BAEA, 0x98E947129FC2B4E9 },
+    { 0xA87FEA27A539E9A5, 0x3F2398D747B36224 },
+    { 0xD29FE4B18E88640E, 0x8EEC7F0D19A03AAD },
+    { 0x83A3EEEEF9153E89, 0x1953CF68300424AC },
+    { 0xA48CEAAAB75A8E2B, 0x5FA8C3423C052DD7 },
+    { 0xCDB02555653131B6, 0x3792F412CB06794D },
+    { 0x808E17555F3EBF11, 0xE2BBD88BBEE40BD0 },
+    { 0xA0B19D2AB70E6ED6, 0x5B6ACEAEAE9D0EC4 },
+    { 0xC8DE047564D20A8B, 0xF245825A5A445275 },
+    { 0xFB158592BE068D2E, 0xEED6E2F0F0D56712 },
+    { 0x9CED737BB6C4183D, 0x55464DD69685606B },
+    { 0xC428D05AA4751E4C, 0xAA97E14C3C26B886 },
+    { 0xF53304714D9265DF, 0xD53DD99F4B3066A8 },
+    { 0x993FE2C6D07B7FAB, 0xE546A8038EFE4029 },
+    { 0xBF8FDB78849A5F96, 0xDE98520472BDD033 },
+    { 0xEF73D256A5C0F77C, 0x963E66858F6D4440 },
+    { 0x95A8637627989AAD, 0xDDE7001379A44AA8 },
+    { 0xBB127C53B17EC159, 0x5560C018580D5D52 },
+    { 0xE9D71B689DDE71AF, 0xAAB8F01E6E10B4A6 },
+    { 0x9226712162AB070D, 0xCAB3961304CA70E8 },
+    { 0xB6B00D69BB55C8D1, 0x3D607B97C5FD0D22 },
+    { 0xE45C10C42A2B3B05, 0x8CB89A7DB77C506A },
+    { 0x8EB98A7A9A5B04E3, 0x77F3608E92ADB242 },
+    { 0xB267ED1940F1C61C, 0x55F038B237591ED3 },
+    { 0xDF01E85F912E37A3, 0x6B6C46DEC52F6688 },
+    { 0x8B61313BBABCE2C6, 0x2323AC4B3B3DA015 },
+    { 0xAE397D8AA96C1B77, 0xABEC975E0A0D081A },
+    { 0xD9C7DCED53C72255, 0x96E7BD358C904A21 },
+    { 0x881CEA14545C7575, 0x7E50D64177DA2E54 },
+    { 0xAA242499697392D2, 0xDDE50BD1D5D0B9E9 },
+    { 0xD4AD2DBFC3D07787, 0x955E4EC64B44E864 },
+    { 0x84EC3C97DA624AB4, 0xBD5AF13BEF0B113E },
+    { 0xA6274BBDD0FADD61, 0xECB1AD8AEACDD58E },
+    { 0xCFB11EAD453994BA, 0x67DE18EDA5814AF2 },
+    { 0x81CEB32C4B43FCF4, 0x80EACF948770CED7 },
+    { 0xA2425FF75E14FC31, 0xA1258379A94D028D },
+    { 0xCAD2F7F5359A3B3E, 0x096EE45813A04330 },
+    { 0xFD87B5F28300CA0D, 0x8BCA9D6E188853FC },
+    { 0x9E74D1B791E07E48, 0x775EA264CF55347E },
+    { 0xC612062576589DDA, 0x95364AFE032A819E },
+    { 0xF79687AED3EEC551, 0x3A83DDBD83F52205 },
+    { 0x9ABE14CD44753B52, 0xC4926A9672793543 },
+    { 0xC16D9A0095928A27, 0x75B7053C0F178294 },
+    { 0xF1C90080BAF72CB1, 0x5324C68B12DD6339 },
+    { 0x971DA05074DA7BEE, 0xD3F6FC16EBCA5E04 },
+    { 0xBCE5086492111AEA, 0x88F4BB1CA6BCF585 },
+    { 0xEC1E4A7DB69561A5, 0x2B31E9E3D06C32E6 },
+    { 0x9392EE8E921D5D07, 0x3AFF322E62439FD0 },
+    { 0xB877AA3236A4B449, 0x09BEFEB9FAD487C3 },
+    { 0xE69594BEC44DE15B, 0x4C2EBE687989A9B4 },
+    { 0x901D7CF73AB0ACD9, 0x0F9D37014BF60A11 },
+    { 0xB424DC35095CD80F, 0x538484C19EF38C95 },
+    { 0xE12E13424BB40E13, 0x2865A5F206B06FBA },
+    { 0x8CBCCC096F5088CB, 0xF93F87B7442E45D4 },
+    { 0xAFEBFF0BCB24AAFE, 0xF78F69A51539D749 },
+    { 0xDBE6FECEBDEDD5BE, 0xB573440E5A884D1C },
+    { 0x89705F4136B4A597, 0x31680A88F8953031 },
+    { 0xABCC77118461CEFC, 0xFDC20D2B36BA7C3E },
+    { 0xD6BF94D5E57A42BC, 0x3D32907604691B4D },
+    { 0x8637BD05AF6C69B5, 0xA63F9A49C2C1B110 },
+    { 0xA7C5AC471B478423, 0x0FCF80DC33721D54 },
+    { 0xD1B71758E219652B, 0xD3C36113404EA4A9 },
+    { 0x83126E978D4FDF3B, 0x645A1CAC083126EA },
+    { 0xA3D70A3D70A3D70A, 0x3D70A3D70A3D70A4 },
+    { 0xCCCCCCCCCCCCCCCC, 0xCCCCCCCCCCCCCCCD },
+    { 0x8000000000000000, 0x0000000000000000 },
+    { 0xA000000000000000, 0x0000000000000000 },
+    { 0xC800000000000000, 0x0000000000000000 },
+    { 0xFA00000000000000, 0x0000000000000000 },
+    { 0x9C40000000000000, 0x0000000000000000 },
+    { 0xC350000000000000, 0x0000000000000000 },
+    { 0xF424000000000000, 0x0000000000000000 },
+    { 0x9896800000000000, 0x0000000000000000 },
+    { 0xBEBC200000000000, 0x0000000000000000 },
+    { 0xEE6B280000000000, 0x0000000000000000 },
+    { 0x9502F90000000000, 0x0000000000000000 },
+    { 0xBA43B74000000000, 0x0000000000000000 },
+    { 0xE8D4A51000000000, 0x0000000000000000 },
+    { 0x9184E72A00000000, 0x0000000000000000 },
+    { 0xB5E620F480000000, 0x0000000000000000 },
+    { 0xE35FA931A0000000, 0x0000000000000000 },
+    { 0x8E1BC9BF04000000, 0x0000000000000000 },
+    { 0xB1A2BC2EC5000000, 0x0000000000000000 },
+    { 0xDE0B6B3A76400000, 0x0000000000000000 },
+    { 0x8AC7230489E80000, 0x0000000000000000 },
+    { 0xAD78EBC5AC620000, 0x0000000000000000 },
+    { 0xD8D726B7177A8000, 0x0000000000000000 },
+    { 0x878678326EAC9000, 0x0000000000000000 },
+    { 0xA968163F0A57B400, 0x0000000000000000 },
+    { 0xD3C21BCECCEDA100, 0x0000000000000000 },
+    { 0x84595161401484A0, 0x0000000000000000 },
+    { 0xA56FA5B99019A5C8, 0x0000000000000000 },
+    { 0xCECB8F27F4200F3A, 0x0000000000000000 },
+    { 0x813F3978F8940984, 0x4000000000000000 },
+    { 0xA18F07D736B90BE5, 0x5000000000000000 },
+    { 0xC9F2C9CD04674EDE, 0xA400000000000000 },
+    { 0xFC6F7C4045812296, 0x4D00000000000000 },
+    { 0x9DC5ADA82B70B59D, 0xF020000000000000 },
+    { 0xC5371912364CE305, 0x6C28000000000000 },
+    { 0xF684DF56C3E01BC6, 0xC732000000000000 },
+    { 0x9A130B963A6C115C, 0x3C7F400000000000 },
+    { 0xC097CE7BC90715B3, 0x4B9F100000000000 },
+    { 0xF0BDC21ABB48DB20, 0x1E86D40000000000 },
+    { 0x96769950B50D88F4, 0x1314448000000000 },
+    { 0xBC143FA4E250EB31, 0x17D955A000000000 },
+    { 0xEB194F8E1AE525FD, 0x5DCFAB0800000000 },
+    { 0x92EFD1B8D0CF37BE, 0x5AA1CAE500000000 },
+    { 0xB7ABC627050305AD, 0xF14A3D9E40000000 },
+    { 0xE596B7B0C643C719, 0x6D9CCD05D0000000 },
+    { 0x8F7E32CE7BEA5C6F, 0xE4820023A2000000 },
+    { 0xB35DBF821AE4F38B, 0xDDA2802C8A800000 },
+    { 0xE0352F62A19E306E, 0xD50B2037AD200000 },
+    { 0x8C213D9DA502DE45, 0x4526F422CC340000 },
+    { 0xAF298D050E4395D6, 0x9670B12B7F410000 },
+    { 0xDAF3F04651D47B4C, 0x3C0CDD765F114000 },
+    { 0x88D8762BF324CD0F, 0xA5880A69FB6AC800 },
+    { 0xAB0E93B6EFEE0053, 0x8EEA0D047A457A00 },
+    { 0xD5D238A4ABE98068, 0x72A4904598D6D880 },
+    { 0x85A36366EB71F041, 0x47A6DA2B7F864750 },
+    { 0xA70C3C40A64E6C51, 0x999090B65F67D924 },
+    { 0xD0CF4B50CFE20765, 0xFFF4B4E3F741CF6D },
+    { 0x82818F1281ED449F, 0xBFF8F10E7A8921A4 },
+    { 0xA321F2D7226895C7, 0xAFF72D52192B6A0D },
+    { 0xCBEA6F8CEB02BB39, 0x9BF4F8A69F764490 },
+    { 0xFEE50B7025C36A08, 0x02F236D04753D5B4 },
+    { 0x9F4F2726179A2245, 0x01D762422C946590 },
+    { 0xC722F0EF9D80AAD6, 0x424D3AD2B7B97EF5 },
+    { 0xF8EBAD2B84E0D58B, 0xD2E0898765A7DEB2 },
+    { 0x9B934C3B330C8577, 0x63CC55F49F88EB2F },
+    { 0xC2781F49FFCFA6D5, 0x3CBF6B71C76B25FB },
+    { 0xF316271C7FC3908A, 0x8BEF464E3945EF7A },
+    { 0x97EDD871CFDA3A56, 0x97758BF0E3CBB5AC },
+    { 0xBDE94E8E43D0C8EC, 0x3D52EEED1CBEA317 },
+    { 0xED63A231D4C4FB27, 0x4CA7AAA863EE4BDD },
+    { 0x945E455F24FB1CF8, 0x8FE8CAA93E74EF6A },
+    { 0xB975D6B6EE39E436, 0xB3E2FD538E122B44 },
+    { 0xE7D34C64A9C85D44, 0x60DBBCA87196B616 },
+    { 0x90E40FBEEA1D3A4A, 0xBC8955E946FE31CD },
+    { 0xB51D13AEA4A488DD, 0x6BABAB6398BDBE41 },
+    { 0xE264589A4DCDAB14, 0xC696963C7EED2DD1 },
+    { 0x8D7EB76070A08AEC, 0xFC1E1DE5CF543CA2 },
+    { 0xB0DE65388CC8ADA8, 0x3B25A55F43294BCB },
+    { 0xDD15FE86AFFAD912, 0x49EF0EB713F39EBE },
+    { 0x8A2DBF142DFCC7AB, 0x6E3569326C784337 },
+    { 0xACB92ED9397BF996, 0x49C2C37F07965404 },
+    { 0xD7E77A8F87DAF7FB, 0xDC33745EC97BE906 },
+    { 0x86F0AC99B4E8DAFD, 0x69A028BB3DED71A3 },
+    { 0xA8ACD7C0222311BC, 0xC40832EA0D68CE0C },
+    { 0xD2D80DB02AABD62B, 0xF50A3FA490C30190 },
+    { 0x83C7088E1AAB65DB, 0x792667C6DA79E0FA },
+    { 0xA4B8CAB1A1563F52, 0x577001B891185938 },
+    { 0xCDE6FD5E09ABCF26, 0xED4C0226B55E6F86 },
+    { 0x80B05E5AC60B6178, 0x544F8158315B05B4 },
+    { 0xA0DC75F1778E39D6, 0x696361AE3DB1C721 },
+    { 0xC913936DD571C84C, 0x03BC3A19CD1E38E9 },
+    { 0xFB5878494ACE3A5F, 0x04AB48A04065C723 },
+    { 0x9D174B2DCEC0E47B, 0x62EB0D64283F9C76 },
+    { 0xC45D1DF942711D9A, 0x3BA5D0BD324F8394 },
+    { 0xF5746577930D6500, 0xCA8F44EC7EE36479 },
+    { 0x9968BF6ABBE85F20, 0x7E998B13CF4E1ECB },
+    { 0xBFC2EF456AE276E8, 0x9E3FEDD8C321A67E },
+    { 0xEFB3AB16C59B14A2, 0xC5CFE94EF3EA101E },
+    { 0x95D04AEE3B80ECE5, 0xBBA1F1D158724A12 },
+    { 0xBB445DA9CA61281F, 0x2A8A6E45AE8EDC97 },
+    { 0xEA1575143CF97226, 0xF52D09D71A3293BD },
+    { 0x924D692CA61BE758, 0x593C2626705F9C56 },
+    { 0xB6E0C377CFA2E12E, 0x6F8B2FB00C77836C },
+    { 0xE498F455C38B997A, 0x0B6DFB9C0F956447 },
+    { 0x8EDF98B59A373FEC, 0x4724BD4189BD5EAC },
+    { 0xB2977EE300C50FE7, 0x58EDEC91EC2CB657 },
+    { 0xDF3D5E9BC0F653E1, 0x2F2967B66737E3ED },
+    { 0x8B865B215899F46C, 0xBD79E0D20082EE74 },
+    { 0xAE67F1E9AEC07187, 0xECD8590680A3AA11 },
+    { 0xDA01EE641A708DE9, 0xE80E6F4820CC9495 },
+    { 0x884134FE908658B2, 0x3109058D147FDCDD },
+    { 0xAA51823E34A7EEDE, 0xBD4B46F0599FD415 },
+    { 0xD4E5E2CDC1D1EA96, 0x6C9E18AC7007C91A },
+    { 0x850FADC09923329E, 0x03E2CF6BC604DDB0 },
+    { 0xA6539930BF6BFF45, 0x84DB8346B786151C },
+    { 0xCFE87F7CEF46FF16, 0xE612641865679A63 },
+    { 0x81F14FAE158C5F6E, 0x4FCB7E8F3F60C07E },
+    { 0xA26DA3999AEF7749, 0xE3BE5E330F38F09D },
+    { 0xCB090C8001AB551C, 0x5CADF5BFD3072CC5 },
+    { 0xFDCB4FA002162A63, 0x73D9732FC7C8F7F6 },
+    { 0x9E9F11C4014DDA7E, 0x2867E7FDDCDD9AFA },
+    { 0xC646D63501A1511D, 0xB281E1FD541501B8 },
+    { 0xF7D88BC24209A565, 0x1F225A7CA91A4226 },
+    { 0x9AE757596946075F, 0x3375788DE9B06958 },
+    { 0xC1A12D2FC3978937, 0x0052D6B1641C83AE },
+    { 0xF209787BB47D6B84, 0xC0678C5DBD23A49A },
+    { 0x9745EB4D50CE6332, 0xF840B7BA963646E0 },
+    { 0xBD176620A501FBFF, 0xB650E5A93BC3D898 },
+    { 0xEC5D3FA8CE427AFF, 0xA3E51F138AB4CEBE },
+    { 0x93BA47C980E98CDF, 0xC66F336C36B10137 },
+    { 0xB8A8D9BBE123F017, 0xB80B0047445D4184 },
+    { 0xE6D3102AD96CEC1D, 0xA60DC059157491E5 },
+    { 0x9043EA1AC7E41392, 0x87C89837AD68DB2F },
+    { 0xB454E4A179DD1877, 0x29BABE4598C311FB },
+    { 0xE16A1DC9D8545E94, 0xF4296DD6FEF3D67A },
+    { 0x8CE2529E2734BB1D, 0x1899E4A65F58660C },
+    { 0xB01AE745B101E9E4, 0x5EC05DCFF72E7F8F },
+    { 0xDC21A1171D42645D, 0x76707543F4FA1F73 },
+    { 0x899504AE72497EBA, 0x6A06494A791C53A8 },
+    { 0xABFA45DA0EDBDE69, 0x0487DB9D17636892 },
+    { 0xD6F8D7509292D603, 0x45A9D2845D3C42B6 },
+    { 0x865B86925B9BC5C2, 0x0B8A2392BA45A9B2 },
+    { 0xA7F26836F282B732, 0x8E6CAC7768D7141E },
+    { 0xD1EF0244AF2364FF, 0x3207D795430CD926 },
+    { 0x8335616AED761F1F, 0x7F44E6BD49E807B8 },
+    { 0xA402B9C5A8D3A6E7, 0x5F16206C9C6209A6 },
+    { 0xCD036837130890A1, 0x36DBA887C37A8C0F },
+    { 0x802221226BE55A64, 0xC2494954DA2C9789 },
+    { 0xA02AA96B06DEB0FD, 0xF2DB9BAA10B7BD6C },
+    { 0xC83553C5C8965D3D, 0x6F92829494E5ACC7 },
+    { 0xFA42A8B73ABBF48C, 0xCB772339BA1F17F9 },
+    { 0x9C69A97284B578D7, 0xFF2A760414536EFB },
+    { 0xC38413CF25E2D70D, 0xFEF5138519684ABA },
+    { 0xF46518C2EF5B8CD1, 0x7EB258665FC25D69 },
+    { 0x98BF2F79D5993802, 0xEF2F773FFBD97A61 },
+    { 0xBEEEFB584AFF8603, 0xAAFB550FFACFD8FA },
+    { 0xEEAABA2E5DBF6784, 0x95BA2A53F983CF38 },
+    { 0x952AB45CFA97A0B2, 0xDD945A747BF26183 },
+    { 0xBA756174393D88DF, 0x94F971119AEEF9E4 },
+    { 0xE912B9D1478CEB17, 0x7A37CD5601AAB85D },
+    { 0x91ABB422CCB812EE, 0xAC62E055C10AB33A },
+    { 0xB616A12B7FE617AA, 0x577B986B314D6009 },
+    { 0xE39C49765FDF9D94, 0xED5A7E85FDA0B80B },
+    { 0x8E41ADE9FBEBC27D, 0x14588F13BE847307 },
+    { 0xB1D219647AE6B31C, 0x596EB2D8AE258FC8 },
+    { 0xDE469FBD99A05FE3, 0x6FCA5F8ED9AEF3BB },
+    { 0x8AEC23D680043BEE, 0x25DE7BB9480D5854 },
+    { 0xADA72CCC20054AE9, 0xAF561AA79A10AE6A },
+    { 0xD910F7FF28069DA4, 0x1B2BA1518094DA04 },
+    { 0x87AA9AFF79042286, 0x90FB44D2F05D0842 },
+    { 0xA99541BF57452B28, 0x353A1607AC744A53 },
+    { 0xD3FA922F2D1675F2, 0x42889B8997915CE8 },
+    { 0x847C9B5D7C2E09B7, 0x69956135FEBADA11 },
+    { 0xA59BC234DB398C25, 0x43FAB9837E699095 },
+    { 0xCF02B2C21207EF2E, 0x94F967E45E03F4BB },
+    { 0x8161AFB94B44F57D, 0x1D1BE0EEBAC278F5 },
+    { 0xA1BA1BA79E1632DC, 0x6462D92A69731732 },
+    { 0xCA28A291859BBF93, 0x7D7B8F7503CFDCFE },
+    { 0xFCB2CB35E702AF78, 0x5CDA735244C3D43E },
+    { 0x9DEFBF01B061ADAB, 0x3A0888136AFA64A7 },
+    { 0xC56BAEC21C7A1916, 0x088AAA1845B8FDD0 },
+    { 0xF6C69A72A3989F5B, 0x8AAD549E57273D45 },
+    { 0x9A3C2087A63F6399, 0x36AC54E2F678864B },
+    { 0xC0CB28A98FCF3C7F, 0x84576A1BB416A7DD },
+    { 0xF0FDF2D3F3C30B9F, 0x656D44A2A11C51D5 },
+    { 0x969EB7C47859E743, 0x9F644AE5A4B1B325 },
+    { 0xBC4665B596706114, 0x873D5D9F0DDE1FEE },
+    { 0xEB57FF22FC0C7959, 0xA90CB506D155A7EA },
+    { 0x9316FF75DD87CBD8, 0x09A7F12442D588F2 },
+    { 0xB7DCBF5354E9BECE, 0x0C11ED6D538AEB2F },
+    { 0xE5D3EF282A242E81, 0x8F1668C8A86DA5FA },
+    { 0x8FA475791A569D10, 0xF96E017D694487BC },
+    { 0xB38D92D760EC4455, 0x37C981DCC395A9AC },
+    { 0xE070F78D3927556A, 0x85BBE253F47B1417 },
+    { 0x8C469AB843B89562, 0x93956D7478CCEC8E },
+    { 0xAF58416654A6BABB, 0x387AC8D1970027B2 },
+    { 0xDB2E51BFE9D0696A, 0x06997B05FCC0319E },
+    { 0x88FCF317F22241E2, 0x441FECE3BDF81F03 },
+    { 0xAB3C2FDDEEAAD25A, 0xD527E81CAD7626C3 },
+    { 0xD60B3BD56A5586F1, 0x8A71E223D8D3B074 },
+    { 0x85C7056562757456, 0xF6872D5667844E49 },
+    { 0xA738C6BEBB12D16C, 0xB428F8AC016561DB },
+    { 0xD106F86E69D785C7, 0xE13336D701BEBA52 },
+    { 0x82A45B450226B39C, 0xECC0024661173473 },
+    { 0xA34D721642B06084, 0x27F002D7F95D0190 },
+    { 0xCC20CE9BD35C78A5, 0x31EC038DF7B441F4 },
+    { 0xFF290242C83396CE, 0x7E67047175A15271 },
+    { 0x9F79A169BD203E41, 0x0F0062C6E984D386 },
+    { 0xC75809C42C684DD1, 0x52C07B78A3E60868 },
+    { 0xF92E0C3537826145, 0xA7709A56CCDF8A82 },
+    { 0x9BBCC7A142B17CCB, 0x88A66076400BB691 },
+    { 0xC2ABF989935DDBFE, 0x6ACFF893D00EA435 },
+    { 0xF356F7EBF83552FE, 0x0583F6B8C4124D43 },
+    { 0x98165AF37B2153DE, 0xC3727A337A8B704A },
+    { 0xBE1BF1B059E9A8D6, 0x744F18C0592E4C5C },
+    { 0xEDA2EE1C7064130C, 0x1162DEF06F79DF73 },
+    { 0x9485D4D1C63E8BE7, 0x8ADDCB5645AC2BA8 },
+    { 0xB9A74A0637CE2EE1, 0x6D953E2BD7173692 },
+    { 0xE8111C87C5C1BA99, 0xC8FA8DB6CCDD0437 },
+    { 0x910AB1D4DB9914A0, 0x1D9C9892400A22A2 },
+    { 0xB54D5E4A127F59C8, 0x2503BEB6D00CAB4B },
+    { 0xE2A0B5DC971F303A, 0x2E44AE64840FD61D },
+    { 0x8DA471A9DE737E24, 0x5CEAECFED289E5D2 },
+    { 0xB10D8E1456105DAD, 0x7425A83E872C5F47 },
+    { 0xDD50F1996B947518, 0xD12F124E28F77719 },
+    { 0x8A5296FFE33CC92F, 0x82BD6B70D99AAA6F },
+    { 0xACE73CBFDC0BFB7B, 0x636CC64D1001550B },
+    { 0xD8210BEFD30EFA5A, 0x3C47F7E05401AA4E },
+    { 0x8714A775E3E95C78, 0x65ACFAEC34810A71 },
+    { 0xA8D9D1535CE3B396, 0x7F1839A741A14D0D },
+    { 0xD31045A8341CA07C, 0x1EDE48111209A050 },
+    { 0x83EA2B892091E44D, 0x934AED0AAB460432 },
+    { 0xA4E4B66B68B65D60, 0xF81DA84D5617853F },
+    { 0xCE1DE40642E3F4B9, 0x36251260AB9D668E },
+    { 0x80D2AE83E9CE78F3, 0xC1D72B7C6B426019 },
+    { 0xA1075A24E4421730, 0xB24CF65B8612F81F },
+    { 0xC94930AE1D529CFC, 0xDEE033F26797B627 },
+    { 0xFB9B7CD9A4A7443C, 0x169840EF017DA3B1 },
+    { 0x9D412E0806E88AA5, 0x8E1F289560EE864E },
+    { 0xC491798A08A2AD4E, 0xF1A6F2BAB92A27E2 },
+    { 0xF5B5D7EC8ACB58A2, 0xAE10AF696774B1DB },
+    { 0x9991A6F3D6BF1765, 0xACCA6DA1E0A8EF29 },
+    { 0xBFF610B0CC6EDD3F, 0x17FD090A58D32AF3 },
+    { 0xEFF394DCFF8A948E, 0xDDFC4B4CEF07F5B0 },
+    { 0x95F83D0A1FB69CD9, 0x4ABDAF101564F98E },
+    { 0xBB764C4CA7A4440F, 0x9D6D1AD41ABE37F1 },
+    { 0xEA53DF5FD18D5513, 0x84C86189216DC5ED },
+    { 0x92746B9BE2F8552C, 0x32FD3CF5B4E49BB4 },
+    { 0xB7118682DBB66A77, 0x3FBC8C33221DC2A1 },
+    { 0xE4D5E82392A40515, 0x0FABAF3FEAA5334A },
+    { 0x8F05B1163BA6832D, 0x29CB4D87F2A7400E },
+    { 0xB2C71D5BCA9023F8, 0x743E20E9EF511012 },
+    { 0xDF78E4B2BD342CF6, 0x914DA9246B255416 },
+    { 0x8BAB8EEFB6409C1A, 0x1AD089B6C2F7548E },
+    { 0xAE9672ABA3D0C320, 0xA184AC2473B529B1 },
+    { 0xDA3C0F568CC4F3E8, 0xC9E5D72D90A2741E },
+    { 0x8865899617FB1871, 0x7E2FA67C7A658892 },
+    { 0xAA7EEBFB9DF9DE8D, 0xDDBB901B98FEEAB7 },
+    { 0xD51EA6FA85785631, 0x552A74227F3EA565 },
+    { 0x8533285C936B35DE, 0xD53A88958F87275F },
+    { 0xA67FF273B8460356, 0x8A892ABAF368F137 },
+    { 0xD01FEF10A657842C, 0x2D2B7569B0432D85 },
+    { 0x8213F56A67F6B29B, 0x9C3B29620E29FC73 },
+    { 0xA298F2C501F45F42, 0x8349F3BA91B47B8F },
+    { 0xCB3F2F7642717713, 0x241C70A936219A73 },
+    { 0xFE0EFB53D30DD4D7, 0xED238CD383AA0110 },
+    { 0x9EC95D1463E8A506, 0xF4363804324A40AA },
+    { 0xC67BB4597CE2CE48, 0xB143C6053EDCD0D5 },
+    { 0xF81AA16FDC1B81DA, 0xDD94B7868E94050A },
+    { 0x9B10A4E5E9913128, 0xCA7CF2B4191C8326 },
+    { 0xC1D4CE1F63F57D72, 0xFD1C2F611F63A3F0 },
+    { 0xF24A01A73CF2DCCF, 0xBC633B39673C8CEC },
+    { 0x976E41088617CA01, 0xD5BE0503E085D813 },
+    { 0xBD49D14AA79DBC82, 0x4B2D8644D8A74E18 },
+    { 0xEC9C459D51852BA2, 0xDDF8E7D60ED1219E },
+    { 0x93E1AB8252F33B45, 0xCABB90E5C942B503 },
+    { 0xB8DA1662E7B00A17, 0x3D6A751F3B936243 },
+    { 0xE7109BFBA19C0C9D, 0x0CC512670A783AD4 },
+    { 0x906A617D450187E2, 0x27FB2B80668B24C5 },
+    { 0xB484F9DC9641E9DA, 0xB1F9F660802DEDF6 },
+    { 0xE1A63853BBD26451, 0x5E7873F8A0396973 },
+    { 0x8D07E33455637EB2, 0xDB0B487B6423E1E8 },
+    { 0xB049DC016ABC5E5F, 0x91CE1A9A3D2CDA62 },
+    { 0xDC5C5301C56B75F7, 0x7641A140CC7810FB },
+    { 0x89B9B3E11B6329BA, 0xA9E904C87FCB0A9D },
+    { 0xAC2820D9623BF429, 0x546345FA9FBDCD44 },
+    { 0xD732290FBACAF133, 0xA97C177947AD4095 },
+    { 0x867F59A9D4BED6C0, 0x49ED8EABCCCC485D },
+    { 0xA81F301449EE8C70, 0x5C68F256BFFF5A74 },
+    { 0xD226FC195C6A2F8C, 0x73832EEC6FFF3111 },
+    { 0x83585D8FD9C25DB7, 0xC831FD53C5FF7EAB },
+    { 0xA42E74F3D032F525, 0xBA3E7CA8B77F5E55 },
+    { 0xCD3A1230C43FB26F, 0x28CE1BD2E55F35EB },
+    { 0x80444B5E7AA7CF85, 0x7980D163CF5B81B3 },
+    { 0xA0555E361951C366, 0xD7E105BCC332621F },
+    { 0xC86AB5C39FA63440, 0x8DD9472BF3FEFAA7 },
+    { 0xFA856334878FC150, 0xB14F98F6F0FEB951 },
+    { 0x9C935E00D4B9D8D2, 0x6ED1BF9A569F33D3 },
+    { 0xC3B8358109E84F07, 0x0A862F80EC4700C8 },
+    { 0xF4A642E14C6262C8, 0xCD27BB612758C0FA },
+    { 0x98E7E9CCCFBD7DBD, 0x8038D51CB897789C },
+    { 0xBF21E44003ACDD2C, 0xE0470A63E6BD56C3 },
+    { 0xEEEA5D5004981478, 0x1858CCFCE06CAC74 },
+    { 0x95527A5202DF0CCB, 0x0F37801E0C43EBC8 },
+    { 0xBAA718E68396CFFD, 0xD30560258F54E6BA },
+    { 0xE950DF20247C83FD, 0x47C6B82EF32A2069 },
+    { 0x91D28B7416CDD27E, 0x4CDC331D57FA5441 },
+    { 0xB6472E511C81471D, 0xE0133FE4ADF8E952 },
+    { 0xE3D8F9E563A198E5, 0x58180FDDD97723A6 },
+    { 0x8E679C2F5E44FF8F, 0x570F09EAA7EA7648 },
+    { 0xB201833B35D63F73, 0x2CD2CC6551E513DA },
+    { 0xDE81E40A034BCF4F, 0xF8077F7EA65E58D1 },
+    { 0x8B112E86420F6191, 0xFB04AFAF27FAF782 },
+    { 0xADD57A27D29339F6, 0x79C5DB9AF1F9B563 },
+    { 0xD94AD8B1C7380874, 0x18375281AE7822BC },
+    { 0x87CEC76F1C830548, 0x8F2293910D0B15B5 },
+    { 0xA9C2794AE3A3C69A, 0xB2EB3875504DDB22 },
+    { 0xD433179D9C8CB841, 0x5FA60692A46151EB },
+    { 0x849FEEC281D7F328, 0xDBC7C41BA6BCD333 },
+    { 0xA5C7EA73224DEFF3, 0x12B9B522906C0800 },
+    { 0xCF39E50FEAE16BEF, 0xD768226B34870A00 },
+    { 0x81842F29F2CCE375, 0xE6A1158300D46640 },
+    { 0xA1E53AF46F801C53, 0x60495AE3C1097FD0 },
+    { 0xCA5E89B18B602368, 0x385BB19CB14BDFC4 },
+    { 0xFCF62C1DEE382C42, 0x46729E03DD9ED7B5 },
+    { 0x9E19DB92B4E31BA9, 0x6C07A2C26A8346D1 },
+    { 0xC5A05277621BE293, 0xC7098B7305241885 },
+    { 0xF70867153AA2DB38, 0xB8CBEE4FC66D1EA7 },
+    { 0x9A65406D44A5C903, 0x737F74F1DC043328 },
+    { 0xC0FE908895CF3B44, 0x505F522E53053FF2 },
+    { 0xF13E34AABB430A15, 0x647726B9E7C68FEF },
+    { 0x96C6E0EAB509E64D, 0x5ECA783430DC19F5 },
+    { 0xBC789925624C5FE0, 0xB67D16413D132072 },
+    { 0xEB96BF6EBADF77D8, 0xE41C5BD18C57E88F },
+    { 0x933E37A534CBAAE7, 0x8E91B962F7B6F159 },
+    { 0xB80DC58E81FE95A1, 0x723627BBB5A4ADB0 },
+    { 0xE61136F2227E3B09, 0xCEC3B1AAA30DD91C },
+    { 0x8FCAC257558EE4E6, 0x213A4F0AA5E8A7B1 },
+    { 0xB3BD72ED2AF29E1F, 0xA988E2CD4F62D19D },
+    { 0xE0ACCFA875AF45A7, 0x93EB1B80A33B8605 },
+    { 0x8C6C01C9498D8B88, 0xBC72F130660533C3 },
+    { 0xAF87023B9BF0EE6A, 0xEB8FAD7C7F8680B4 },
+    { 0xDB68C2CA82ED2A05, 0xA67398DB9F6820E1 },
+    { 0x892179BE91D43A43, 0x88083F8943A1148C },
+    { 0xAB69D82E364948D4, 0x6A0A4F6B948959B0 },
+    { 0xD6444E39C3DB9B09, 0x848CE34679ABB01C },
+    { 0x85EAB0E41A6940E5, 0xF2D80E0C0C0B4E11 },
+    { 0xA7655D1D2103911F, 0x6F8E118F0F0E2195 },
+    { 0xD13EB46469447567, 0x4B7195F2D2D1A9FB },
+};
+
+
+static const uint64_t _json_pow10_u64[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+    100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+};
+
+
+static const double _json_pow10_double[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+
+static const float _json_pow10_float[11] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+};
 
 
-PVJDEF JsonError
-json_reader_open_object(JSON* state, JSON* object) {
-    _TokenType token;
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) {
-        return err;
+static JsonError
+_json_number_to_integer(const _JsonNumber* number, long long* value) {
+    uint64_t x = number->mantissa;
+    int e = number->exponent;
+    if (e < 0) {
+        x = e < -19 ? 0 : x / _json_pow10_u64[-e];
     }
-    switch (token) {
-        case _TokenType_object_open:
-            break;
-        case _TokenType_null_value:
-            return JsonError_null;
-        default:
-            return JsonError_type_mismatch;
+    else if (e > 0 && x != 0) {
+        if (e > 19 || x > UINT64_MAX / _json_pow10_u64[e]) {
+            return JsonError_range;
+        }
+        x *= _json_pow10_u64[e];
     }
-    err = json_reader_init(object, state->_file);
-    return err;
+    if (number->negative) {
+        if (x > (uint64_t) LLONG_MAX + 1) { return JsonError_range; }
+        *value = x == 0 ? 0 : -(long long) (x - 1) - 1;
+    }
+    else {
+        if (x > (uint64_t) LLONG_MAX) { return JsonError_range; }
+        *value = (long long) x;
+    }
+    return JsonError_ok;
 }
 
 
-PVJDEF JsonError
-json_reader_read_object(JSON* state, size_t* key_size, char* key, JsonValueType* value) {
-    _TokenType token;
-    if (state->_element_count != 0) {
-        JsonError err = _json_parser_read_token(state, state->_file, &token);
-        if (err != JsonError_ok) { return err; }
-        switch (token) {
-            case _TokenType_object_close:
-                return JsonError_not_found;
-            case _TokenType_value_separator:
-                break;
-            default:
-                return JsonError_invalid;
+static uint64_t
+_json_umul128(uint64_t a, uint64_t b, uint64_t* lo) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128) a * b;
+    *lo = (uint64_t) r;
+    return (uint64_t) (r >> 64);
+#else
+    uint64_t a0 = (uint32_t) a, a1 = a >> 32;
+    uint64_t b0 = (uint32_t) b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t) p01 + (uint32_t) p10;
+    *lo = (mid << 32) | (uint32_t) p00;
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+
+typedef struct {
+    int mantissa_bits;
+    int exponent_bits;
+    int bias;
+} _JsonFloatFormat;
+
+
+static const _JsonFloatFormat _json_float64_format = { 52, 11, -1023 };
+static const _JsonFloatFormat _json_float32_format = { 23, 8, -127 };
+
+
+/* Eisel-Lemire: converts mantissa * 10^exponent to the nearest binary
+   float, or returns 0 when the result cannot be decided from a 128-bit
+   approximation of the power of ten. */
+static int
+_json_eisel_lemire(uint64_t mantissa, int exponent, int negative, const _JsonFloatFormat* format, uint64_t* bits) {
+    if (mantissa == 0) {
+        *bits = (uint64_t) negative << (format->mantissa_bits + format->exponent_bits);
+        return 1;
+    }
+    if (exponent < _JSON_POW10_MIN || exponent > _JSON_POW10_MAX) {
+        return 0;
+    }
+    const uint64_t* pow10 = _json_pow10_table[exponent - _JSON_POW10_MIN];
+    int clz = __builtin_clzll(mantissa);
+    mantissa <<= clz;
+    int shift = 64 - format->mantissa_bits - 3;
+    uint64_t mask = ((uint64_t) 1 << shift) - 1;
+    int64_t exp2 = ((int64_t) 217706 * exponent >> 16) + 64 - format->bias - clz;
+
+    uint64_t lo;
+    uint64_t hi = _json_umul128(mantissa, pow10[0], &lo);
+    if ((hi & mask) == mask && lo + mantissa < mantissa) {
+        uint64_t lo2;
+        uint64_t hi2 = _json_umul128(mantissa, pow10[1], &lo2);
+        uint64_t merged_hi = hi;
+        uint64_t merged_lo = lo + hi2;
+        if (merged_lo < lo) { merged_hi++; }
+        if ((merged_hi & mask) == mask && merged_lo + 1 == 0 && lo2 + mantissa < mantissa) {
+            return 0;
         }
+        hi = merged_hi;
+        lo = merged_lo;
     }
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) { return err; }
-    switch (token) {
-        case _TokenType_string_open:
-            break;
+
+    uint64_t msb = hi >> 63;
+    uint64_t m = hi >> (msb + shift);
+    exp2 -= 1 ^ msb;
+    if (lo == 0 && (hi & mask) == 0 && (m & 3) == 1) {
+        return 0;
+    }
+    m += m & 1;
+    m >>= 1;
+    if (m >> (format->mantissa_bits + 1) != 0) {
+        m >>= 1;
+        exp2 += 1;
+    }
+    int64_t exp_max = ((int64_t) 1 << format->exponent_bits) - 1;
+    if (exp2 <= 0 || exp2 >= exp_max) {
+        return 0;
+    }
+    *bits = ((uint64_t) exp2 << format->mantissa_bits)
+        | (m & (((uint64_t) 1 << format->mantissa_bits) - 1))
+        | ((uint64_t) negative << (format->mantissa_bits + format->exponent_bits));
+    return 1;
+}
+
+
+static void
+_json_decimal_trim(_JsonDecimal* a) {
+    while (a->count > 0 && a->digits[a->count - 1] == 0) {
+        a->count--;
+    }
+    if (a->count == 0) {
+        a->point = 0;
+    }
+}
+
+
+static void
+_json_decimal_right_shift(_JsonDecimal* a, unsigned int k) {
+    int r = 0;
+    int w = 0;
+    uint64_t n = 0;
+    for (; (n >> k) == 0; r++) {
+        if (r >= a->count) {
+            if (n == 0) {
+                a->count = 0;
+                return;
+            }
+            while ((n >> k) == 0) {
+                n = n * 10;
+                r++;
+            }
+            break;
+        }
+        n = n * 10 + a->digits[r];
+    }
+    a->point -= r - 1;
+    uint64_t mask = ((uint64_t) 1 << k) - 1;
+    for (; r < a->count; r++) {
+        uint64_t x = n >> k;
+        n &= mask;
+        a->digits[w++] = x;
+        n = n * 10 + a->digits[r];
+    }
+    while (n > 0) {
+        uint64_t x = n >> k;
+        n &= mask;
+        if (w < (int) sizeof(a->digits)) {
+            a->digits[w++] = x;
+        }
+        else if (x > 0) {
+            a->truncated = 1;
+        }
+        n = n * 10;
+    }
+    a->count = w;
+    _json_decimal_trim(a);
+}
+
+
+static void
+_json_decimal_left_shift(_JsonDecimal* a, unsigned int k) {
+    /* at most floor(k * log10(2)) + 1 new digits; written from the right,
+       then moved down if the leading one was not needed */
+    int delta = ((int) k * 1233 >> 12) + 1;
+    int w = a->count + delta;
+    int r = a->count - 1;
+    uint64_t n = 0;
+    for (; r >= 0; r--) {
+        n += (uint64_t) a->digits[r] << k;
+        uint64_t quo = n / 10;
+        uint64_t rem = n - 10 * quo;
+        w--;
+        if (w < (int) sizeof(a->digits)) {
+            a->digits[w] = rem;
+        }
+        else if (rem != 0) {
+            a->truncated = 1;
+        }
+        n = quo;
+    }
+    while (n > 0) {
+        uint64_t quo = n / 10;
+        uint64_t rem = n - 10 * quo;
+        w--;
+        if (w < (int) sizeof(a->digits)) {
+            a->digits[w] = rem;
+        }
+        else if (rem != 0) {
+            a->truncated = 1;
+        }
+        n = quo;
+    }
+    int count = a->count + delta;
+    if (count > (int) sizeof(a->digits)) {
+        count = sizeof(a->digits);
+    }
+    if (w > 0) {
+        memmove(a->digits, a->digits + w, count - w);
+    }
+    a->count = count - w;
+    a->point += delta - w;
+    _json_decimal_trim(a);
+}
+
+
+static void
+_json_decimal_shift(_JsonDecimal* a, int k) {
+    if (a->count == 0) {
+        return;
+    }
+    for (; k > 60; k -= 60) {
+        _json_decimal_left_shift(a, 60);
+    }
+    for (; k < -60; k += 60) {
+        _json_decimal_right_shift(a, 60);
+    }
+    if (k > 0) {
+        _json_decimal_left_shift(a, k);
+    }
+    else if (k < 0) {
+        _json_decimal_right_shift(a, -k);
+    }
+}
+
+
+static int
+_json_decimal_round_up(const _JsonDecimal* a, int nd) {
+    if (nd < 0 || nd >= a->count) {
+        return 0;
+    }
+    if (a->digits[nd] == 5 && nd + 1 == a->count) {
+        if (a->truncated) {
+            return 1;
+        }
+        return nd > 0 && a->digits[nd - 1] % 2 == 1;
+    }
+    return a->digits[nd] >= 5;
+}
+
+
+static uint64_t
+_json_decimal_rounded_integer(const _JsonDecimal* a) {
+    if (a->point > 20) {
+        return UINT64_MAX;
+    }
+    uint64_t n = 0;
+    int i = 0;
+    for (; i < a->point && i < a->count; i++) {
+        n = n * 10 + a->digits[i];
+    }
+    for (; i < a->point; i++) {
+        n *= 10;
+    }
+    if (_json_decimal_round_up(a, a->point)) {
+        n++;
+    }
+    return n;
+}
+
+
+/* Exact decimal to binary conversion by repeated binary shifts of the
+   decimal digits. Slow, but correct for any input. */
+static uint64_t
+_json_decimal_to_bits(_JsonDecimal* a, const _JsonFloatFormat* format) {
+    static const int powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+    const int npowtab = sizeof(powtab) / sizeof(powtab[0]);
+    const int exp_limit = (1 << format->exponent_bits) - 1;
+    int exp = 0;
+    uint64_t m = 0;
+
+    _json_decimal_trim(a);
+    if (a->count == 0 || a->point < -330) {
+        exp = format->bias;
+        goto out;
+    }
+    if (a->point > 310) {
+        goto overflow;
+    }
+
+    while (a->point > 0) {
+        int n = a->point >= npowtab ? 27 : powtab[a->point];
+        _json_decimal_shift(a, -n);
+        exp += n;
+    }
+    while (a->point < 0 || (a->point == 0 && a->digits[0] < 5)) {
+        int n = -a->point >= npowtab ? 27 : powtab[-a->point];
+        _json_decimal_shift(a, n);
+        exp -= n;
+    }
+    exp--;
+    if (exp < format->bias + 1) {
+        int n = format->bias + 1 - exp;
+        _json_decimal_shift(a, -n);
+        exp += n;
+    }
+    if (exp - format->bias >= exp_limit) {
+        goto overflow;
+    }
+    _json_decimal_shift(a, 1 + format->mantissa_bits);
+    m = _json_decimal_rounded_integer(a);
+    if (m == (uint64_t) 2 << format->mantissa_bits) {
+        m >>= 1;
+        exp++;
+        if (exp - format->bias >= exp_limit) {
+            goto overflow;
+        }
+    }
+    if ((m & ((uint64_t) 1 << format->mantissa_bits)) == 0) {
+        exp = format->bias;
+    }
+    goto out;
+
+overflow:
+    m = 0;
+    exp = exp_limit + format->bias;
+
+out:
+    return (m & (((uint64_t) 1 << format->mantissa_bits) - 1))
+        | ((uint64_t) ((exp - format->bias) & exp_limit) << format->mantissa_bits)
+        | ((uint64_t) (a->negative != 0) << (format->mantissa_bits + format->exponent_bits));
+}
+
+
+static uint64_t
+_json_number_to_bits(_JsonNumber* number, const _JsonFloatFormat* format) {
+    uint64_t bits;
+    if (_json_eisel_lemire(number->mantissa, number->exponent, number->negative, format, &bits)) {
+        if (!number->truncated) {
+            return bits;
+        }
+        uint64_t upper;
+        if (_json_eisel_lemire(number->mantissa + 1, number->exponent, number->negative, format, &upper) && upper == bits) {
+            return bits;
+        }
+    }
+    return _json_decimal_to_bits(number->decimal, format);
+}
+
+
+static double
+_json_number_to_double(_JsonNumber* number) {
+    uint64_t m = number->mantissa;
+    int e = number->exponent;
+    if (!number->truncated && (m >> 53) == 0) {
+        /* Clinger's fast path: both operands are exact doubles */
+        double x = (double) m;
+        if (number->negative) { x = -x; }
+        if (e == 0) {
+            return x;
+        }
+        if (e > 0 && e <= 15 + 22) {
+            if (e > 22) {
+                x *= _json_pow10_double[e - 22];
+                e = 22;
+            }
+            if (x <= 1e15 && x >= -1e15) {
+                return x * _json_pow10_double[e];
+            }
+        }
+        else if (e < 0 && e >= -22) {
+            return x / _json_pow10_double[-e];
+        }
+    }
+    uint64_t bits = _json_number_to_bits(number, &_json_float64_format);
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+
+static float
+_json_number_to_float(_JsonNumber* number) {
+    uint64_t m = number->mantissa;
+    int e = number->exponent;
+    if (!number->truncated && (m >> 24) == 0) {
+        float x = (float) m;
+        if (number->negative) { x = -x; }
+        if (e == 0) {
+            return x;
+        }
+        if (e > 0 && e <= 7 + 10) {
+            if (e > 10) {
+                x *= _json_pow10_float[e - 10];
+                e = 10;
+            }
+            if (x <= 1e7f && x >= -1e7f) {
+                return x * _json_pow10_float[e];
+            }
+        }
+        else if (e < 0 && e >= -10) {
+            return x / _json_pow10_float[-e];
+        }
+    }
+    uint32_t bits = _json_number_to_bits(number, &_json_float32_format);
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+
+PVJDEF JsonError
+json_reader_init(JSON* state, FILE* file) {
+    _json_stream_init(state, file, NULL, 0, NULL, NULL, NULL);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_init_buffer(JSON* state, const char* data, size_t size) {
+    _json_stream_init(state, NULL, data, size, NULL, NULL, NULL);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_init_source(JSON* state, JsonReadFunc read, void* user_data) {
+    _json_stream_init(state, NULL, NULL, 0, read, NULL, user_data);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_init_unlocked(JSON* state, FILE* file) {
+    JsonError err = json_reader_init(state, file);
+    if (err != JsonError_ok) { return err; }
+#if PAIV_JSON_POSIX
+    flockfile(file);
+    state->_stream->_flags |= _JsonStreamFlag_unlocked;
+#endif
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_init_mmap(JSON* state, const char* path) {
+#if PAIV_JSON_POSIX
+    /* nonblocking so that opening a FIFO does not wait for a writer */
+    int fd = open(path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0) { return JsonError_read; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return JsonError_read;
+    }
+    size_t size = st.st_size;
+    const char* data = NULL;
+    if (size != 0) {
+        void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return JsonError_read;
+        }
+        posix_madvise(p, size, POSIX_MADV_SEQUENTIAL);
+        data = (const char*) p;
+    }
+    close(fd);
+    JsonError err = json_reader_init_buffer(state, data, size);
+    if (size != 0) {
+        state->_stream->_flags |= _JsonStreamFlag_mapped;
+    }
+    return err;
+#else
+    (void) state;
+    (void) path;
+    return JsonError_read;
+#endif
+}
+
+
+#if PAIV_JSON_POSIX
+/* Rounds a pipelined reader's threads poll the other side's counter
+   with sched_yield before they go to sleep on it. */
+#define _JSON_PIPE_SPIN 64
+
+
+/* Control block of a pipelined reader, at the start of the caller's
+   storage and followed by the buffer sizes and the buffers. The
+   producer thread owns _filled and the reader owns _consumed; each
+   only reads the other's counter, so buffers change hands without
+   locks. A side that finds the ring full or empty for a while sets its
+   _sleeps flag and blocks reading its pipe, _wake for the producer and
+   _ready for the reader; the other side writes a byte there only when
+   it sees the flag. The producer waits for input in poll() together
+   with _wake, which json_reader_close also writes to so that a
+   producer blocked on a pipe or socket stops. */
+typedef struct {
+    pthread_t _thread;
+    int _fd;
+    int _wake[2];
+    int _ready[2];
+    char* _buffers;
+    size_t* _sizes;
+    size_t _buffer_size;
+    size_t _count;
+    size_t _filled;
+    size_t _consumed;
+    int _producer_sleeps;
+    int _reader_sleeps;
+    int _held;
+    int _done;
+    int _stop;
+    JsonError _status;
+} _JsonPipe;
+
+
+/* Blocks until the other side of a pipelined reader writes to fd. */
+static void
+_json_pipe_sleep(int fd) {
+    char c;
+    while (read(fd, &c, 1) < 0 && errno == EINTR) {
+    }
+}
+
+
+/* Wakes the side of a pipelined reader that announced in *sleeps that
+   it is about to block on fd, after the counter it waits for moved. */
+static void
+_json_pipe_wake(int* sleeps, int fd) {
+    if (__atomic_load_n(sleeps, __ATOMIC_SEQ_CST) && __atomic_exchange_n(sleeps, 0, __ATOMIC_SEQ_CST)) {
+        char c = 0;
+        while (write(fd, &c, 1) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+
+/* Fills free buffers with read() until end of input, a read error or
+   a stop request from json_reader_close. */
+static void*
+_json_pipe_produce(void* arg) {
+    _JsonPipe* ring = (_JsonPipe*) arg;
+    JsonError status = JsonError_eof;
+    size_t filled = 0;
+    for (;;) {
+        for (int spin = 0; filled - __atomic_load_n(&ring->_consumed, __ATOMIC_SEQ_CST) == ring->_count; ++spin) {
+            if (__atomic_load_n(&ring->_stop, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+            if (spin < _JSON_PIPE_SPIN) {
+                sched_yield();
+                continue;
+            }
+            __atomic_store_n(&ring->_producer_sleeps, 1, __ATOMIC_SEQ_CST);
+            if (filled - __atomic_load_n(&ring->_consumed, __ATOMIC_SEQ_CST) != ring->_count ||
+                __atomic_load_n(&ring->_stop, __ATOMIC_ACQUIRE)) {
+                /* the reader may have taken the flag and owe a byte */
+                if (__atomic_exchange_n(&ring->_producer_sleeps, 0, __ATOMIC_SEQ_CST)) {
+                    continue;
+                }
+            }
+            _json_pipe_sleep(ring->_wake[0]);
+        }
+        if (__atomic_load_n(&ring->_stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        struct pollfd fds[2];
+        fds[0].fd = ring->_fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = ring->_wake[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            status = JsonError_read;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        size_t slot = filled % ring->_count;
+        ssize_t n = read(ring->_fd, ring->_buffers + slot * ring->_buffer_size, ring->_buffer_size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            status = JsonError_read;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        ring->_sizes[slot] = n;
+        __atomic_store_n(&ring->_filled, ++filled, __ATOMIC_SEQ_CST);
+        _json_pipe_wake(&ring->_reader_sleeps, ring->_ready[1]);
+    }
+    ring->_status = status;
+    __atomic_store_n(&ring->_done, 1, __ATOMIC_SEQ_CST);
+    _json_pipe_wake(&ring->_reader_sleeps, ring->_ready[1]);
+    return NULL;
+}
+
+
+/* Read callback of a pipelined reader: returns the buffer handed out
+   by the previous call to the producer and waits for the next one. */
+static JsonError
+_json_pipe_read(void* user_data, const char** data, size_t* size) {
+    _JsonPipe* ring = (_JsonPipe*) user_data;
+    size_t consumed = __atomic_load_n(&ring->_consumed, __ATOMIC_RELAXED);
+    if (ring->_held) {
+        ring->_held = 0;
+        __atomic_store_n(&ring->_consumed, ++consumed, __ATOMIC_SEQ_CST);
+        _json_pipe_wake(&ring->_producer_sleeps, ring->_wake[1]);
+    }
+    for (int spin = 0; __atomic_load_n(&ring->_filled, __ATOMIC_SEQ_CST) == consumed; ++spin) {
+        if (__atomic_load_n(&ring->_done, __ATOMIC_SEQ_CST)) {
+            if (__atomic_load_n(&ring->_filled, __ATOMIC_SEQ_CST) == consumed) {
+                return ring->_status;
+            }
+            break;
+        }
+        if (spin < _JSON_PIPE_SPIN) {
+            sched_yield();
+            continue;
+        }
+        __atomic_store_n(&ring->_reader_sleeps, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->_filled, __ATOMIC_SEQ_CST) != consumed ||
+            __atomic_load_n(&ring->_done, __ATOMIC_SEQ_CST)) {
+            /* the producer may have taken the flag and owe a byte */
+            if (__atomic_exchange_n(&ring->_reader_sleeps, 0, __ATOMIC_SEQ_CST)) {
+                continue;
+            }
+        }
+        _json_pipe_sleep(ring->_ready[0]);
+    }
+    size_t slot = consumed % ring->_count;
+    *data = ring->_buffers + slot * ring->_buffer_size;
+    *size = ring->_sizes[slot];
+    ring->_held = 1;
+    return JsonError_ok;
+}
+
+
+static JsonError
+_json_pipe_stop(_JsonPipe* ring) {
+    __atomic_store_n(&ring->_stop, 1, __ATOMIC_RELEASE);
+    char c = 0;
+    while (write(ring->_wake[1], &c, 1) < 0 && errno == EINTR) {
+    }
+    pthread_join(ring->_thread, NULL);
+    close(ring->_wake[0]);
+    close(ring->_wake[1]);
+    close(ring->_ready[0]);
+    close(ring->_ready[1]);
+    return ring->_status == JsonError_read ? JsonError_read : JsonError_ok;
+}
+#endif
+
+
+/* Storage needed by json_reader_init_pipe for this many buffers. */
+PVJDEF size_t
+json_reader_pipe_storage_size(size_t buffer_size, int buffers) {
+#if PAIV_JSON_POSIX
+    return sizeof(void*) - 1 + sizeof(_JsonPipe) + (size_t) buffers * (sizeof(size_t) + buffer_size);
+#else
+    (void) buffer_size;
+    (void) buffers;
+    return 0;
+#endif
+}
+
+
+/* Reads a file through a ring of buffers in caller storage, filled by
+   a producer thread with read() on the file's descriptor while the
+   reader parses, so I/O stalls overlap parsing. The FILE's own buffer
+   is bypassed, so nothing should have been read through it. The ring
+   holds as many buffers of buffer_size bytes as fit in storage, and at
+   least two; size it with json_reader_pipe_storage_size. The producer
+   runs until the end of input or json_reader_close, which must be
+   called and reports read errors. */
+PVJDEF JsonError
+json_reader_init_pipe(JSON* state, FILE* file, size_t buffer_size, void* storage, size_t storage_size) {
+    /* an empty reader until the producer runs, so close is harmless */
+    json_reader_init_buffer(state, NULL, 0);
+#if PAIV_JSON_POSIX
+    if (buffer_size == 0 || storage_size < json_reader_pipe_storage_size(buffer_size, 2)) {
+        return JsonError_bufsize;
+    }
+    int fd = fileno(file);
+    if (fd < 0) {
+        return JsonError_read;
+    }
+    uintptr_t base = ((uintptr_t) storage + sizeof(void*) - 1) & ~(uintptr_t) (sizeof(void*) - 1);
+    _JsonPipe* ring = (_JsonPipe*) base;
+    size_t count = ((char*) storage + storage_size - (char*) (ring + 1)) / (sizeof(size_t) + buffer_size);
+    ring->_fd = fd;
+    ring->_sizes = (size_t*) (ring + 1);
+    ring->_buffers = (char*) (ring->_sizes + count);
+    ring->_buffer_size = buffer_size;
+    ring->_count = count;
+    ring->_filled = 0;
+    ring->_consumed = 0;
+    ring->_producer_sleeps = 0;
+    ring->_reader_sleeps = 0;
+    ring->_held = 0;
+    ring->_done = 0;
+    ring->_stop = 0;
+    ring->_status = JsonError_eof;
+    if (pipe(ring->_wake) != 0) {
+        return JsonError_read;
+    }
+    if (pipe(ring->_ready) != 0) {
+        close(ring->_wake[0]);
+        close(ring->_wake[1]);
+        return JsonError_read;
+    }
+    if (pthread_create(&ring->_thread, NULL, _json_pipe_produce, ring) != 0) {
+        close(ring->_wake[0]);
+        close(ring->_wake[1]);
+        close(ring->_ready[0]);
+        close(ring->_ready[1]);
+        return JsonError_read;
+    }
+    JsonError err = json_reader_init_source(state, _json_pipe_read, ring);
+    state->_stream->_flags |= _JsonStreamFlag_piped;
+    return err;
+#else
+    (void) file;
+    (void) buffer_size;
+    (void) storage;
+    (void) storage_size;
+    return JsonError_read;
+#endif
+}
+
+
+PVJDEF JsonError
+json_reader_close(JSON* state) {
+    JsonStream* stream = state->_stream;
+#if PAIV_JSON_POSIX
+    if (stream->_flags & _JsonStreamFlag_unlocked) {
+        funlockfile(stream->_file);
+    }
+    if (stream->_flags & _JsonStreamFlag_mapped) {
+        if (munmap((void*) stream->_head, stream->_end - stream->_head) != 0) {
+            stream->_flags = 0;
+            return JsonError_read;
+        }
+    }
+    if (stream->_flags & _JsonStreamFlag_piped) {
+        stream->_flags = 0;
+        return _json_pipe_stop((_JsonPipe*) stream->_user_data);
+    }
+#endif
+    stream->_flags = 0;
+    return JsonError_ok;
+}
+
+
+/* Lowers the nesting limit of json_reader_consume_value and
+   json_document_parse for this reader; depth must be between 1 and
+   PAIV_JSON_MAX_DEPTH. */
+PVJDEF JsonError
+json_reader_set_max_depth(JSON* state, int depth) {
+    if (depth < 1 || depth > PAIV_JSON_MAX_DEPTH) {
+        return JsonError_range;
+    }
+    state->_stream->_max_depth = depth;
+    return JsonError_ok;
+}
+
+
+/* Records the offset of every structural character and opening quote
+   of a buffer or mapped reader into entries, pairs each bracket with
+   its match, and attaches the index to the reader so skipping a
+   container jumps to its closing bracket instead of scanning bytes. On
+   input *count is the capacity of entries; on output it is the number
+   of entries, or the number needed when JsonError_bufsize is returned.
+   The array must outlive the reader. */
+PVJDEF JsonError
+json_reader_build_index(JSON* state, JsonIndexEntry* entries, size_t* count) {
+    JsonStream* stream = state->_stream;
+    if (stream->_file != NULL || stream->_read != NULL) {
+        return JsonError_invalid;
+    }
+    const char* head = stream->_head;
+    size_t size = stream->_end - head;
+    if (size > UINT32_MAX) {
+        return JsonError_range;
+    }
+    size_t capacity = *count;
+    size_t n = 0;
+    /* open containers form a stack linked through _close, holding the
+       parent's entry number plus one until the match is found */
+    size_t open = 0;
+    uint64_t escape_carry = 0;
+    uint64_t in_string_carry = 0;
+    for (size_t base = 0; base < size; base += 64) {
+        const char* p = head + base;
+        char tail[64];
+        if (size - base < 64) {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, size - base);
+            p = tail;
+        }
+        _JsonBlockMasks masks;
+        _json_index_masks(p, &masks);
+        uint64_t quotes = masks.quotes;
+        uint64_t structurals = masks.opens | masks.closes | masks.separators;
+        if (masks.backslashes != 0 || escape_carry != 0) {
+            quotes &= ~_json_index_escaped(masks.backslashes, &escape_carry);
+        }
+        uint64_t in_string = _json_prefix_xor(quotes) ^ in_string_carry;
+        in_string_carry = (uint64_t) ((int64_t) in_string >> 63);
+        uint64_t bits = (structurals & ~in_string) | (quotes & in_string);
+        uint64_t opens = masks.opens & ~in_string;
+        uint64_t closes = masks.closes & ~in_string;
+        while (bits != 0) {
+            if (n < capacity) {
+                uint64_t bit = bits & (~bits + 1);
+                JsonIndexEntry* entry = &entries[n];
+                entry->_offset = (uint32_t) (base + __builtin_ctzll(bits));
+                entry->_close = 0;
+                if (opens & bit) {
+                    entry->_close = (uint32_t) open;
+                    open = n + 1;
+                }
+                else if ((closes & bit) && open != 0) {
+                    JsonIndexEntry* top = &entries[open - 1];
+                    open = top->_close;
+                    top->_close = (uint32_t) n;
+                }
+            }
+            n++;
+            bits &= bits - 1;
+        }
+    }
+    *count = n;
+    if (n > capacity) {
+        return JsonError_bufsize;
+    }
+    while (open != 0) {
+        /* unclosed containers are walked entry by entry */
+        JsonIndexEntry* top = &entries[open - 1];
+        open = top->_close;
+        top->_close = 0;
+    }
+    if (in_string_carry != 0) {
+        return JsonError_eof;
+    }
+    stream->_index = entries;
+    stream->_index_count = n;
+    stream->_index_pos = 0;
+    return JsonError_ok;
+}
+
+
+static void
+_json_reader_init_nested(JSON* state, JSON* nested) {
+    nested->_stream = state->_stream;
+    nested->_element_count = 0;
+    _json_parser_init(nested);
+}
+
+
+/* Positions object inside the object at the reader. The nested reader
+   shares the stream of the root reader initialized by json_reader_init*,
+   so it is only valid while that root JSON is alive and not moved or
+   closed; do not return nested readers out of the root's scope. */
+PVJDEF JsonError
+json_reader_open_object(JSON* state, JSON* object) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_object_open:
+            break;
+        case _TokenType_null_value:
+            return JsonError_null;
+        default:
+            return JsonError_type_mismatch;
+    }
+    _json_reader_init_nested(state, object);
+    return JsonError_ok;
+}
+
+
+static JsonError
+_json_reader_open_key(JSON* state) {
+    _TokenType token;
+    if (state->_element_count != 0) {
+        JsonError err = _json_parser_read_token(state, state->_stream, &token);
+        if (err != JsonError_ok) { return err; }
+        switch (token) {
+            case _TokenType_object_close:
+                return JsonError_not_found;
+            case _TokenType_value_separator:
+                break;
+            default:
+                return JsonError_invalid;
+        }
+    }
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) { return err; }
+    switch (token) {
+        case _TokenType_string_open:
+            return JsonError_ok;
         case _TokenType_object_close:
             if (state->_element_count != 0) {
                 return JsonError_invalid;
@@ -815,461 +3288,2187 @@ json_reader_read_object(JSON* state, size_t* key_size, char* key, JsonValueType*
         default:
             return JsonError_invalid;
     }
-    err = _json_parser_read_string(state, state->_file, key_size, key);
-    if (err != JsonError_ok) {
-        return err;
+}
+
+
+static JsonError
+_json_reader_close_key(JSON* state, JsonValueType* value) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_key_separator:
+            break;
+        default:
+            return JsonError_invalid;
+    }
+    state->_element_count++;
+    if (value) {
+        err = json_reader_peek_value(state, value);
+        return err;
+    }
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_object(JSON* state, size_t* key_size, char* key, JsonValueType* value) {
+    JsonError err = _json_reader_open_key(state);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    err = _json_parser_read_string(state, state->_stream, key_size, key);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    return _json_reader_close_key(state, value);
+}
+
+
+PVJDEF JsonError
+json_key_table_init(JsonKeyTable* table, const char* const* keys, int count) {
+    for (int i = 1; i < count; ++i) {
+        if (strcmp(keys[i - 1], keys[i]) >= 0) {
+            return JsonError_invalid;
+        }
+    }
+    table->_keys = keys;
+    table->_count = count;
+    return JsonError_ok;
+}
+
+
+/* First key in [lo, hi) whose byte at pos is >= c, or > c when upper is
+   set. Keys in the range share their first pos bytes, so the bytes at
+   pos are sorted. */
+static int
+_json_key_table_bound(const JsonKeyTable* table, int lo, int hi, size_t pos, unsigned char c, int upper) {
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        unsigned char x = table->_keys[mid][pos];
+        if (x < c || (upper && x == c)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+
+/* Narrows [*lo, *hi) to the keys that continue with data at offset. */
+static void
+_json_key_table_narrow(const JsonKeyTable* table, int* lo, int* hi, size_t offset, const char* data, size_t size) {
+    int a = *lo;
+    int b = *hi;
+    for (size_t i = 0; i < size && a < b; ++i) {
+        unsigned char c = data[i];
+        if (c == 0) {
+            b = a;
+            break;
+        }
+        a = _json_key_table_bound(table, a, b, offset + i, c, 0);
+        b = _json_key_table_bound(table, a, b, offset + i, c, 1);
+    }
+    *lo = a;
+    *hi = b;
+}
+
+
+PVJDEF JsonError
+json_reader_read_object_key(JSON* state, const JsonKeyTable* table, int* key_id, JsonValueType* value) {
+    JsonError err = _json_reader_open_key(state);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    JsonStream* stream = state->_stream;
+    int lo = 0;
+    int hi = table->_count;
+    size_t offset = 0;
+    const char* p = stream->_ptr;
+    const char* q = _json_scan_string(p, stream->_end);
+    if (q != stream->_end && *q == '"') {
+        offset = q - p;
+        _json_key_table_narrow(table, &lo, &hi, 0, p, offset);
+        stream->_ptr = q + 1;
+    }
+    else {
+        char chunk[64];
+        for (;;) {
+            size_t size = sizeof(chunk);
+            err = _json_parser_read_string(state, stream, &size, chunk);
+            if (err != JsonError_ok && err != JsonError_bufsize) {
+                return err;
+            }
+            _json_key_table_narrow(table, &lo, &hi, offset, chunk, size);
+            offset += size;
+            if (err == JsonError_ok) {
+                break;
+            }
+            if (lo == hi) {
+                err = _json_parser_consume_string(state, stream);
+                if (err != JsonError_ok) {
+                    return err;
+                }
+                break;
+            }
+        }
+    }
+    *key_id = lo < hi && table->_keys[lo][offset] == '\0' ? lo : -1;
+    return _json_reader_close_key(state, value);
+}
+
+
+PVJDEF JsonError
+json_reader_read_object_view(JSON* state, JsonStringView* key, size_t scratch_size, char* scratch, JsonValueType* value) {
+    JsonError err = _json_reader_open_key(state);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    /* reading past the key refills the window of a source reader */
+    JsonStream* stream = state->_stream;
+    err = _json_parser_read_string_view(state, stream, key, scratch_size, scratch, stream->_read == NULL);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    return _json_reader_close_key(state, value);
+}
+
+
+/* Positions array inside the array at the reader; like an object
+   reader, it borrows the root reader's stream. */
+PVJDEF JsonError
+json_reader_open_array(JSON* state, JSON* array) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_array_open:
+            break;
+        case _TokenType_null_value:
+            return JsonError_null;
+        default:
+            return JsonError_type_mismatch;
+    }
+    _json_reader_init_nested(state, array);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_array(JSON* state, JsonValueType* value) {
+    _TokenType token;
+    if (state->_element_count != 0) {
+        JsonError err = _json_parser_read_token(state, state->_stream, &token);
+        if (err != JsonError_ok) { return err; }
+        switch (token) {
+            case _TokenType_array_close:
+                return JsonError_not_found;
+            case _TokenType_value_separator:
+                break;
+            default:
+                return JsonError_invalid;
+        }
+    }
+    JsonError err = _json_parser_peek_token(state, state->_stream, &token);
+    if (err != JsonError_ok) { return err; }
+    switch (token) {
+        case _TokenType_bool_false:
+            if (value) { *value = JsonValueType_false; }
+            break;
+        case _TokenType_bool_true:
+            if (value) { *value = JsonValueType_true; }
+            break;
+        case _TokenType_array_open:
+            if (value) { *value = JsonValueType_array; }
+            break;
+        case _TokenType_object_open:
+            if (value) { *value = JsonValueType_object; }
+            break;
+        case _TokenType_string_open:
+            if (value) { *value = JsonValueType_string; }
+            break;
+        case _TokenType_number:
+            if (value) { *value = JsonValueType_number; }
+            break;
+        case _TokenType_null_value:
+            if (value) { *value = JsonValueType_null; }
+            break;
+        case _TokenType_array_close:
+            if (state->_element_count != 0) {
+                return JsonError_invalid;
+            }
+            _json_parser_read_token(state, state->_stream, &token);
+            return JsonError_not_found;
+        case _TokenType_object_close:
+        case _TokenType_key_separator:
+        case _TokenType_value_separator:
+        case _TokenType_string_close:
+        case _TokenType_invalid:
+            return JsonError_invalid;
+    }
+    state->_element_count++;
+    return JsonError_ok;
+}
+
+
+static JsonError
+_json_reader_read_number(JSON* state, _JsonNumber* number) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_number:
+            break;
+        case _TokenType_null_value:
+            return JsonError_null;
+        default:
+            return JsonError_type_mismatch;
+    }
+    err = _json_parser_read_number(state, state->_stream, number);
+    return err;
+}
+
+
+PVJDEF JsonError
+json_reader_read_numberi(JSON* state, int* value) {
+    long long x;
+    JsonError err = json_reader_read_numberll(state, &x);
+    if (err != JsonError_ok) { return err; }
+    if (x < INT_MIN || x > INT_MAX) { return JsonError_range; }
+    *value = (int) x;
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_numberl(JSON* state, long* value) {
+    long long x;
+    JsonError err = json_reader_read_numberll(state, &x);
+    if (err != JsonError_ok) { return err; }
+    if (x < LONG_MIN || x > LONG_MAX) { return JsonError_range; }
+    *value = (long) x;
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_numberll(JSON* state, long long* value) {
+    _JsonNumber number;
+    number.decimal = NULL;
+    JsonError err = _json_reader_read_number(state, &number);
+    if (err != JsonError_ok) { return err; }
+    return _json_number_to_integer(&number, value);
+}
+
+
+PVJDEF JsonError
+json_reader_read_numberf(JSON* state, float* value) {
+    _JsonDecimal decimal;
+    _JsonNumber number;
+    number.decimal = &decimal;
+    JsonError err = _json_reader_read_number(state, &number);
+    if (err != JsonError_ok) { return err; }
+    *value = _json_number_to_float(&number);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_numberd(JSON* state, double* value) {
+    _JsonDecimal decimal;
+    _JsonNumber number;
+    number.decimal = &decimal;
+    JsonError err = _json_reader_read_number(state, &number);
+    if (err != JsonError_ok) { return err; }
+    *value = _json_number_to_double(&number);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_numberld(JSON* state, long double* value) {
+    _JsonDecimal decimal;
+    _JsonNumber number;
+    number.decimal = &decimal;
+    JsonError err = _json_reader_read_number(state, &number);
+    if (err != JsonError_ok) { return err; }
+    int e = number.exponent;
+    if (LDBL_MANT_DIG >= 64 && !number.truncated && e >= -27 && e <= 27) {
+        /* both operands are exact in a 64-bit significand, one rounding */
+        long double x = number.mantissa;
+        long double p = 1;
+        for (int i = e < 0 ? -e : e; i > 0; --i) { p *= 10; }
+        x = e < 0 ? x / p : x * p;
+        *value = number.negative ? -x : x;
+        return JsonError_ok;
+    }
+    char buf[sizeof(decimal.digits) + 32];
+    int n = 0;
+    if (decimal.negative) { buf[n++] = '-'; }
+    for (int i = 0; i < decimal.count; ++i) { buf[n++] = '0' + decimal.digits[i]; }
+    if (decimal.truncated) { buf[n++] = '1'; }
+    if (n == 0 || (n == 1 && decimal.negative)) { buf[n++] = '0'; }
+    snprintf(buf + n, sizeof(buf) - n, "e%d", decimal.point - decimal.count - decimal.truncated);
+    *value = strtold(buf, NULL);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_string(JSON* state, size_t* buf_size, char* buf) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_string_open:
+            break;
+        case _TokenType_null_value:
+            return JsonError_null;
+        default:
+            return JsonError_type_mismatch;
+    }
+    err = _json_parser_read_string(state, state->_stream, buf_size, buf);
+    return err;
+}
+
+
+PVJDEF JsonError
+json_reader_read_string_view(JSON* state, JsonStringView* view, size_t scratch_size, char* scratch) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_string_open:
+            break;
+        case _TokenType_null_value:
+            return JsonError_null;
+        default:
+            return JsonError_type_mismatch;
+    }
+    err = _json_parser_read_string_view(state, state->_stream, view, scratch_size, scratch, 1);
+    return err;
+}
+
+
+PVJDEF JsonError
+json_reader_resume_string(JSON* state, size_t* buf_size, char* buf) {
+    JsonError err = _json_parser_read_string(state, state->_stream, buf_size, buf);
+    return err;
+}
+
+
+PVJDEF JsonError
+json_reader_read_bool(JSON* state, int* value) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_bool_false:
+            *value = 0;
+            break;
+        case _TokenType_bool_true:
+            *value = 1;
+            break;
+        case _TokenType_null_value:
+            return JsonError_null;
+        case _TokenType_array_open:
+        case _TokenType_object_open:
+        case _TokenType_string_open:
+        case _TokenType_number:
+            return JsonError_type_mismatch;
+        default:
+            return JsonError_invalid;
+    }
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_reader_read_null(JSON* state) {
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_null_value:
+            break;
+        case _TokenType_bool_false:
+        case _TokenType_bool_true:
+        case _TokenType_array_open:
+        case _TokenType_object_open:
+        case _TokenType_string_open:
+        case _TokenType_number:
+            return JsonError_type_mismatch;
+        default:
+            return JsonError_invalid;
+    }
+    return JsonError_ok;
+}
+
+
+static JsonError _json_reader_consume_container(JSON* state, int is_object);
+
+
+PVJDEF JsonError
+json_reader_consume_value(JSON* state) {
+    _TokenType token;
+    JsonError err = _json_parser_peek_token(state, state->_stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_null_value:
+        case _TokenType_bool_false:
+        case _TokenType_bool_true:
+            err = _json_parser_read_token(state, state->_stream, &token);
+            return err;
+        case _TokenType_string_open: {
+            err = _json_parser_read_token(state, state->_stream, &token);
+            if (err != JsonError_ok) { return err; }
+            err = _json_parser_consume_string(state, state->_stream);
+            return err;
+            }
+        case _TokenType_number: {
+            _JsonNumber number;
+            number.decimal = NULL;
+            err = _json_parser_read_number(state, state->_stream, &number);
+            return err;
+            }
+        case _TokenType_array_open:
+        case _TokenType_object_open:
+            err = _json_parser_read_token(state, state->_stream, &token);
+            if (err != JsonError_ok) { return err; }
+            err = _json_reader_consume_container(state, token == _TokenType_object_open);
+            return err;
+        default:
+            return JsonError_invalid;
+    }
+}
+
+
+/* Like json_reader_consume_value, but only finds where the value ends:
+   nested keys, escapes, numbers and literals are not validated. */
+PVJDEF JsonError
+json_reader_skip_value(JSON* state) {
+    _TokenType token;
+    JsonStream* stream = state->_stream;
+    JsonError err = _json_parser_read_token(state, stream, &token);
+    if (err != JsonError_ok) {
+        return err;
+    }
+    switch (token) {
+        case _TokenType_null_value:
+        case _TokenType_bool_false:
+        case _TokenType_bool_true:
+            return JsonError_ok;
+        case _TokenType_string_open:
+            return _json_parser_skip_string(stream);
+        case _TokenType_number:
+            state->_parser_token = _TokenType_invalid;
+            for (;;) {
+                int c = _json_stream_getc(stream);
+                switch (c) {
+                    case '0' ... '9':
+                    case '-':
+                    case '+':
+                    case '.':
+                    case 'e':
+                    case 'E':
+                        break;
+                    default:
+                        _json_stream_ungetc(stream, c);
+                        return JsonError_ok;
+                }
+            }
+        case _TokenType_array_open:
+        case _TokenType_object_open:
+            return _json_parser_skip_container(stream);
+        default:
+            return JsonError_invalid;
+    }
+}
+
+
+/* Finds the next record of newline-delimited JSON. Blank lines are
+   passed over; the rest of the previous record's line must be blank,
+   otherwise JsonError_invalid is returned and json_reader_skip_record
+   resynchronizes at the next line. Returns JsonError_eof after the
+   last record. Line numbers assume one record per line. */
+PVJDEF JsonError
+json_reader_next_record(JSON* state, JsonRecord* record) {
+    JsonStream* stream = state->_stream;
+    int in_record = state->_element_count != 0;
+    for (;;) {
+        int c = _json_stream_getc(stream);
+        switch (c) {
+            case EOF:
+                state->_element_count = 0;
+                return JsonError_eof;
+            case '\n':
+                stream->_line++;
+                in_record = 0;
+                break;
+            case 0x09:
+            case 0x0D:
+            case 0x20:
+                break;
+            default:
+                _json_stream_ungetc(stream, c);
+                if (in_record) {
+                    return JsonError_invalid;
+                }
+                record->offset = stream->_offset + (stream->_ptr - stream->_head);
+                record->line = stream->_line + 1;
+                stream->_record = record->offset;
+                stream->_newline = 0;
+                stream->_newlines = 0;
+                stream->_flags |= _JsonStreamFlag_records;
+                state->_element_count = 1;
+                _json_parser_init(state);
+                return JsonError_ok;
+        }
+    }
+}
+
+
+/* Drops the rest of the current line, such as a malformed record. When
+   the record already read past the end of its line, as with a string
+   left open, the next record starts after that newline; a FILE reader
+   seeks back to it and returns JsonError_read if the FILE cannot seek.
+   A source reader whose window with that newline was already refilled
+   resumes at the next line instead, keeping line numbers in step. */
+PVJDEF JsonError
+json_reader_skip_record(JSON* state) {
+    JsonStream* stream = state->_stream;
+    int in_record = state->_element_count != 0;
+    state->_element_count = 0;
+    _json_parser_init(state);
+    /* a record that failed past a newline, such as a raw one inside a
+       string, ended there; resync after it instead of at the next one */
+    if (in_record && stream->_file != NULL) {
+        if (stream->_newline > stream->_record) {
+            /* the parser may have read on into the next record */
+            if (stream->_newline != stream->_offset) {
+                long back = (long) (stream->_offset - stream->_newline);
+                if (fseek(stream->_file, -back, SEEK_CUR) != 0) {
+                    return JsonError_read;
+                }
+                stream->_offset = stream->_newline;
+            }
+            stream->_line++;
+            return JsonError_ok;
+        }
+    }
+    else if (in_record && stream->_newline > stream->_record) {
+        /* the newline went out with a refilled window, so there is no
+           stepping back; count the lines the record spanned instead */
+        _json_stream_count_newlines(stream, stream->_ptr);
+        stream->_line += stream->_newlines;
+    }
+    else if (in_record && stream->_head != NULL) {
+        const char* p = stream->_head;
+        if (stream->_record > stream->_offset) {
+            p += stream->_record - stream->_offset;
+        }
+        const char* q = (const char*) memchr(p, '\n', stream->_ptr - p);
+        if (q != NULL) {
+            stream->_ptr = q + 1;
+            stream->_line++;
+            return JsonError_ok;
+        }
+    }
+    for (;;) {
+        const char* p = stream->_ptr;
+        if (p != stream->_end) {
+            const char* q = (const char*) memchr(p, '\n', stream->_end - p);
+            if (q == NULL) {
+                stream->_ptr = stream->_end;
+                continue;
+            }
+            stream->_ptr = q;
+        }
+        int c = _json_stream_getc(stream);
+        if (c == EOF) {
+            return JsonError_ok;
+        }
+        if (c == '\n') {
+            stream->_line++;
+            return JsonError_ok;
+        }
+    }
+}
+
+
+/* A byte range of a top-level array scanned by one worker. The first
+   pass measures the range without knowing whether it starts inside a
+   string; the second finds its first element boundary and the closing
+   bracket once the starting state is known. */
+typedef struct {
+    const char* _begin;
+    const char* _end;
+    int _quotes;
+    long _depth_change[2];
+    int _in_string;
+    long _depth;
+    const char* _boundary;
+    const char* _close;
+} _JsonArrayRange;
+
+
+typedef struct {
+    const JsonParallel* _options;
+    const char* _head;
+    const char* _next;
+    const char* _end;
+    int _max_depth;
+    _JsonArrayRange* _ranges;
+    size_t _range_count;
+    const char* const* _cuts;
+    size_t _cut_count;
+    size_t _chunk_index;
+    size_t _commit_index;
+    size_t _line;
+    JsonError _error;
+#if PAIV_JSON_POSIX
+    pthread_mutex_t _lock;
+    pthread_cond_t _turn;
+#endif
+} _JsonParallelRun;
+
+
+typedef struct {
+    _JsonParallelRun* _run;
+    int _worker;
+} _JsonParallelWorker;
+
+
+static void
+_json_parallel_lock(_JsonParallelRun* run) {
+#if PAIV_JSON_POSIX
+    pthread_mutex_lock(&run->_lock);
+#else
+    (void) run;
+#endif
+}
+
+
+static void
+_json_parallel_unlock(_JsonParallelRun* run) {
+#if PAIV_JSON_POSIX
+    pthread_mutex_unlock(&run->_lock);
+#else
+    (void) run;
+#endif
+}
+
+
+static void
+_json_parallel_init(_JsonParallelRun* run, JsonParallel* options, const JsonParallel* parallel, const JsonStream* stream) {
+    *options = *parallel;
+    if (options->chunk_size == 0) {
+        options->chunk_size = 1 << 20;
+    }
+    if (options->threads < 1) {
+        options->threads = 1;
+    }
+    if (options->threads > PAIV_JSON_MAX_THREADS) {
+        options->threads = PAIV_JSON_MAX_THREADS;
+    }
+    run->_options = options;
+    run->_head = stream->_head;
+    run->_next = stream->_ptr;
+    run->_end = stream->_end;
+    run->_max_depth = stream->_max_depth;
+    run->_ranges = NULL;
+    run->_range_count = 0;
+    run->_cuts = NULL;
+    run->_cut_count = 0;
+    run->_chunk_index = 0;
+    run->_commit_index = 0;
+    run->_line = stream->_line;
+    run->_error = JsonError_ok;
+#if PAIV_JSON_POSIX
+    pthread_mutex_init(&run->_lock, NULL);
+    pthread_cond_init(&run->_turn, NULL);
+#endif
+}
+
+
+static void
+_json_parallel_destroy(_JsonParallelRun* run) {
+#if PAIV_JSON_POSIX
+    pthread_cond_destroy(&run->_turn);
+    pthread_mutex_destroy(&run->_lock);
+#else
+    (void) run;
+#endif
+}
+
+
+/* Runs func on every worker of the run, the calling thread being worker
+   0. Without POSIX threads worker 0 does all the work. */
+static void
+_json_parallel_spawn(_JsonParallelRun* run, void* (*func)(void*)) {
+    int threads = run->_options->threads;
+    _JsonParallelWorker workers[PAIV_JSON_MAX_THREADS];
+    for (int i = 0; i < threads; ++i) {
+        workers[i]._run = run;
+        workers[i]._worker = i;
+    }
+#if PAIV_JSON_POSIX
+    pthread_t ids[PAIV_JSON_MAX_THREADS];
+    int started = 1;
+    for (; started < threads; ++started) {
+        if (pthread_create(&ids[started], NULL, func, &workers[started]) != 0) {
+            break;
+        }
+    }
+    func(&workers[0]);
+    for (int i = 1; i < started; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+#else
+    func(&workers[0]);
+#endif
+}
+
+
+static JsonError
+_json_parallel_parse_chunk(_JsonParallelRun* run, int worker, JsonChunk* chunk) {
+    const JsonParallel* options = run->_options;
+    JSON reader;
+    json_reader_init_buffer(&reader, run->_head + chunk->offset, chunk->size);
+    reader._stream->_offset = chunk->offset;
+    reader._stream->_max_depth = run->_max_depth;
+    chunk->records = 0;
+    JsonError err;
+    for (;;) {
+        JsonRecord record;
+        err = json_reader_next_record(&reader, &record);
+        if (err != JsonError_ok) {
+            /* JsonError_invalid is trailing bytes after a record */
+            break;
+        }
+        chunk->records++;
+        err = options->record(options->user_data, worker, &reader, &record);
+        if (err != JsonError_ok) {
+            break;
+        }
+    }
+    chunk->line = reader._stream->_line;
+    return err == JsonError_eof ? JsonError_ok : err;
+}
+
+
+/* Reads the elements of an array slice, which holds whole elements
+   separated by commas, through a frame as if the slice were the inside
+   of an array. */
+static JsonError
+_json_parallel_parse_elements(_JsonParallelRun* run, int worker, JsonChunk* chunk) {
+    const JsonParallel* options = run->_options;
+    const char* data = run->_head + chunk->offset;
+    size_t size = chunk->size;
+    chunk->records = 0;
+    chunk->line = 0;
+    while (size != 0 && (data[size - 1] == 0x20 || data[size - 1] == 0x0A || data[size - 1] == 0x0D || data[size - 1] == 0x09)) {
+        size--;
+    }
+    if ((size == 0 && run->_cut_count > 2) || (size != 0 && data[size - 1] == ',')) {
+        return JsonError_invalid;
+    }
+    JSON reader;
+    JSON frame;
+    json_reader_init_buffer(&reader, data, size);
+    JsonStream* stream = reader._stream;
+    stream->_offset = chunk->offset;
+    stream->_max_depth = run->_max_depth;
+    _json_reader_init_nested(&reader, &frame);
+    for (;;) {
+        JsonValueType type;
+        JsonError err = json_reader_read_array(&frame, &type);
+        if (err == JsonError_eof) {
+            break;
+        }
+        if (err != JsonError_ok) {
+            return JsonError_invalid;
+        }
+        JsonRecord record;
+        record.offset = stream->_offset + (stream->_ptr - stream->_head);
+        record.line = 0;
+        chunk->records++;
+        err = options->record(options->user_data, worker, &frame, &record);
+        if (err != JsonError_ok) {
+            return err;
+        }
+    }
+    return JsonError_ok;
+}
+
+
+/* Takes the next chunk under the lock. Records chunks run from the end
+   of the previous one past the next newline after chunk_size; array
+   slices lie between consecutive cuts. */
+static int
+_json_parallel_take(_JsonParallelRun* run, const char** start, const char** end) {
+    if (run->_cuts != NULL) {
+        if (run->_chunk_index + 1 >= run->_cut_count) {
+            return 0;
+        }
+        *start = run->_cuts[run->_chunk_index] + 1;
+        *end = run->_cuts[run->_chunk_index + 1];
+        return 1;
+    }
+    if (run->_next == run->_end) {
+        return 0;
+    }
+    *start = run->_next;
+    *end = run->_end;
+    size_t chunk_size = run->_options->chunk_size;
+    if ((size_t) (*end - *start) > chunk_size) {
+        const char* p = *start + chunk_size;
+        const char* q = (const char*) memchr(p, '\n', *end - p);
+        *end = q != NULL ? q + 1 : *end;
+    }
+    run->_next = *end;
+    return 1;
+}
+
+
+/* Takes chunks until the input or the run ends, and commits each one
+   under the lock, in input order when requested. */
+static void*
+_json_parallel_worker(void* arg) {
+    _JsonParallelWorker* self = (_JsonParallelWorker*) arg;
+    _JsonParallelRun* run = self->_run;
+    const JsonParallel* options = run->_options;
+    for (;;) {
+        JsonChunk chunk;
+        const char* start;
+        const char* end;
+        _json_parallel_lock(run);
+        if (run->_error != JsonError_ok || !_json_parallel_take(run, &start, &end)) {
+            _json_parallel_unlock(run);
+            return NULL;
+        }
+        chunk.index = run->_chunk_index++;
+        _json_parallel_unlock(run);
+
+        chunk.offset = start - run->_head;
+        chunk.size = end - start;
+        JsonError err = run->_cuts != NULL ?
+            _json_parallel_parse_elements(run, self->_worker, &chunk) :
+            _json_parallel_parse_chunk(run, self->_worker, &chunk);
+        size_t lines = chunk.line;
+
+        _json_parallel_lock(run);
+#if PAIV_JSON_POSIX
+        while (options->ordered && run->_commit_index != chunk.index && run->_error == JsonError_ok) {
+            pthread_cond_wait(&run->_turn, &run->_lock);
+        }
+#endif
+        if (err == JsonError_ok && run->_error == JsonError_ok && options->commit != NULL) {
+            chunk.line = options->ordered && run->_cuts == NULL ? run->_line + 1 : 0;
+            err = options->commit(options->user_data, self->_worker, &chunk);
+        }
+        if (err != JsonError_ok && run->_error == JsonError_ok) {
+            run->_error = err;
+        }
+        run->_line += lines;
+        run->_commit_index++;
+#if PAIV_JSON_POSIX
+        pthread_cond_broadcast(&run->_turn);
+#endif
+        _json_parallel_unlock(run);
+    }
+}
+
+
+/* Reads newline-delimited JSON from a buffer or mapped reader on a pool
+   of threads. Each worker owns a reader over its chunk and hands every
+   record to the record callback, then the chunk to commit. The first
+   error returned by a callback, or JsonError_invalid for bytes after a
+   record on its line, stops the run and is returned. Without
+   POSIX threads the chunks are read on the calling thread. */
+PVJDEF JsonError
+json_reader_parallel_records(JSON* state, const JsonParallel* parallel) {
+    JsonStream* stream = state->_stream;
+    if (stream->_file != NULL || stream->_read != NULL || parallel->record == NULL) {
+        return JsonError_invalid;
+    }
+    if (stream->_ptr == NULL) {
+        return JsonError_ok;
+    }
+    JsonParallel options;
+    _JsonParallelRun run;
+    _json_parallel_init(&run, &options, parallel, stream);
+    _json_parallel_spawn(&run, _json_parallel_worker);
+    _json_parallel_destroy(&run);
+    stream->_ptr = stream->_end;
+    stream->_line = run._line;
+    return run._error;
+}
+
+
+/* Loads the masks of the 64-byte block at p, padding bytes past end
+   with spaces, and drops escaped quotes. */
+static void
+_json_array_block(const char* p, const char* end, uint64_t* escape_carry, _JsonBlockMasks* masks) {
+    char tail[64];
+    if (end - p < 64) {
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, p, end - p);
+        p = tail;
+    }
+    _json_index_masks(p, masks);
+    if (masks->backslashes != 0 || *escape_carry != 0) {
+        masks->quotes &= ~_json_index_escaped(masks->backslashes, escape_carry);
+    }
+}
+
+
+/* Counts the quotes of a range and its change in bracket depth, once
+   assuming the range starts outside a string and once inside. Ranges
+   never start on an escaped character. */
+static void
+_json_array_measure(_JsonArrayRange* range) {
+    uint64_t escape_carry = 0;
+    uint64_t in_string_carry = 0;
+    long outside = 0;
+    long inside = 0;
+    for (const char* p = range->_begin; p < range->_end; p += 64) {
+        _JsonBlockMasks masks;
+        _json_array_block(p, range->_end, &escape_carry, &masks);
+        uint64_t in_string = _json_prefix_xor(masks.quotes) ^ in_string_carry;
+        in_string_carry = (uint64_t) ((int64_t) in_string >> 63);
+        outside += __builtin_popcountll(masks.opens & ~in_string) - __builtin_popcountll(masks.closes & ~in_string);
+        inside += __builtin_popcountll(masks.opens & in_string) - __builtin_popcountll(masks.closes & in_string);
+    }
+    range->_quotes = in_string_carry != 0;
+    range->_depth_change[0] = outside;
+    range->_depth_change[1] = inside;
+}
+
+
+/* Walks the brackets of a range from its known starting state, noting
+   the first comma between top-level elements and the bracket closing
+   the array. */
+static void
+_json_array_split(_JsonArrayRange* range) {
+    range->_boundary = NULL;
+    range->_close = NULL;
+    long depth = range->_depth;
+    if (depth <= 0) {
+        return;
+    }
+    uint64_t escape_carry = 0;
+    uint64_t in_string_carry = range->_in_string ? ~(uint64_t) 0 : 0;
+    for (const char* p = range->_begin; p < range->_end; p += 64) {
+        _JsonBlockMasks masks;
+        _json_array_block(p, range->_end, &escape_carry, &masks);
+        uint64_t in_string = _json_prefix_xor(masks.quotes) ^ in_string_carry;
+        in_string_carry = (uint64_t) ((int64_t) in_string >> 63);
+        uint64_t bits = (masks.opens | masks.closes | masks.separators) & ~in_string;
+        for (; bits != 0; bits &= bits - 1) {
+            const char* c = p + __builtin_ctzll(bits);
+            switch (*c) {
+                case '[':
+                case '{':
+                    depth++;
+                    break;
+                case ']':
+                case '}':
+                    if (--depth == 0) {
+                        range->_close = c;
+                        return;
+                    }
+                    break;
+                case ',':
+                    if (depth == 1 && range->_boundary == NULL) {
+                        range->_boundary = c;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+
+static void*
+_json_array_measure_worker(void* arg) {
+    _JsonParallelRun* run = ((_JsonParallelWorker*) arg)->_run;
+    for (;;) {
+        _json_parallel_lock(run);
+        size_t i = run->_chunk_index++;
+        _json_parallel_unlock(run);
+        if (i >= run->_range_count) {
+            return NULL;
+        }
+        _json_array_measure(&run->_ranges[i]);
+    }
+}
+
+
+static void*
+_json_array_split_worker(void* arg) {
+    _JsonParallelRun* run = ((_JsonParallelWorker*) arg)->_run;
+    for (;;) {
+        _json_parallel_lock(run);
+        size_t i = run->_chunk_index++;
+        _json_parallel_unlock(run);
+        if (i >= run->_range_count) {
+            return NULL;
+        }
+        _json_array_split(&run->_ranges[i]);
+    }
+}
+
+
+/* Reads the elements of a top-level array from a buffer or mapped
+   reader on a pool of threads. The bytes after the opening bracket are
+   cut into ranges that are scanned in parallel for quotes and brackets;
+   a short sequential pass then gives each range its starting string
+   state and depth, so a second parallel scan can place slice boundaries
+   on commas between top-level elements. Slices are read like the
+   chunks of json_reader_parallel_records: every element goes to the
+   record callback with a frame positioned at it and its byte offset,
+   and line numbers are 0. On success the reader is left after the
+   closing bracket. */
+PVJDEF JsonError
+json_reader_parallel_array(JSON* state, const JsonParallel* parallel) {
+    JsonStream* stream = state->_stream;
+    if (stream->_file != NULL || stream->_read != NULL || parallel->record == NULL) {
+        return JsonError_invalid;
     }
-    err = _json_parser_read_token(state, state->_file, &token);
+    _TokenType token;
+    JsonError err = _json_parser_read_token(state, stream, &token);
     if (err != JsonError_ok) {
         return err;
     }
     switch (token) {
-        case _TokenType_key_separator:
+        case _TokenType_array_open:
             break;
+        case _TokenType_null_value:
+            return JsonError_null;
         default:
+            return JsonError_type_mismatch;
+    }
+    JsonParallel options;
+    _JsonParallelRun run;
+    _json_parallel_init(&run, &options, parallel, stream);
+
+    _JsonArrayRange ranges[4 * PAIV_JSON_MAX_THREADS];
+    const char* begin = stream->_ptr;
+    const char* end = stream->_end;
+    size_t size = end - begin;
+    size_t count = size / options.chunk_size + 1;
+    if (count > 4 * (size_t) options.threads) {
+        count = 4 * (size_t) options.threads;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const char* p = begin + (size / count) * i;
+        if (i != 0) {
+            if (p < ranges[i - 1]._begin) {
+                p = ranges[i - 1]._begin;
+            }
+            while (p < end && p[-1] == '\\') {
+                ++p;
+            }
+            ranges[i - 1]._end = p;
+        }
+        ranges[i]._begin = p;
+    }
+    ranges[count - 1]._end = end;
+    run._ranges = ranges;
+    run._range_count = count;
+    _json_parallel_spawn(&run, _json_array_measure_worker);
+
+    int in_string = 0;
+    long depth = 1;
+    for (size_t i = 0; i < count; ++i) {
+        ranges[i]._in_string = in_string;
+        ranges[i]._depth = depth;
+        depth += ranges[i]._depth_change[in_string];
+        in_string ^= ranges[i]._quotes;
+    }
+    run._chunk_index = 0;
+    _json_parallel_spawn(&run, _json_array_split_worker);
+
+    const char* cuts[4 * PAIV_JSON_MAX_THREADS + 2];
+    size_t cut_count = 0;
+    cuts[cut_count++] = begin - 1;
+    const char* close = NULL;
+    for (size_t i = 0; i < count && close == NULL; ++i) {
+        if (i != 0 && ranges[i]._boundary != NULL) {
+            cuts[cut_count++] = ranges[i]._boundary;
+        }
+        close = ranges[i]._close;
+    }
+    if (close == NULL) {
+        _json_parallel_destroy(&run);
+        return JsonError_eof;
+    }
+    cuts[cut_count++] = close;
+    run._cuts = cuts;
+    run._cut_count = cut_count;
+    run._chunk_index = 0;
+    _json_parallel_spawn(&run, _json_parallel_worker);
+    _json_parallel_destroy(&run);
+    if (run._error == JsonError_ok) {
+        stream->_ptr = close + 1;
+    }
+    return run._error;
+}
+
+
+/* Decodes the next reference token of a JSON Pointer into token,
+   undoing ~0 and ~1 escapes, and returns the rest of the pointer. */
+static const char*
+_json_pointer_next(const char* pointer, char* token, size_t token_size, size_t* size, JsonError* err) {
+    size_t n = 0;
+    for (; *pointer != '\0' && *pointer != '/'; ++pointer) {
+        char c = *pointer;
+        if (c == '~') {
+            switch (*++pointer) {
+                case '0':
+                    c = '~';
+                    break;
+                case '1':
+                    c = '/';
+                    break;
+                default:
+                    *err = JsonError_invalid;
+                    return NULL;
+            }
+        }
+        if (n == token_size - 1) {
+            *err = JsonError_bufsize;
+            return NULL;
+        }
+        token[n++] = c;
+    }
+    token[n] = '\0';
+    *size = n;
+    return pointer;
+}
+
+
+/* Parses an array index token: digits without leading zeros. */
+static int
+_json_pointer_index(const char* token, size_t size, size_t* index) {
+    if (size == 0 || (token[0] == '0' && size > 1)) {
+        return 0;
+    }
+    size_t x = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (token[i] < '0' || token[i] > '9' || x > (SIZE_MAX - 9) / 10) {
+            return 0;
+        }
+        x = x * 10 + (token[i] - '0');
+    }
+    *index = x;
+    return 1;
+}
+
+
+/* Moves forward to the value at an RFC 6901 JSON Pointer relative to
+   the next value, such as "/menu/items/3/label", passing over other
+   members with json_reader_skip_value. On success the target is next
+   in the stream and is read with the value functions of this context;
+   the containers around it are left open. Reference tokens are limited
+   to 255 bytes. */
+PVJDEF JsonError
+json_reader_seek_pointer(JSON* state, const char* pointer) {
+    char token[256];
+    const char* keys[1] = {token};
+    JsonStream* stream = state->_stream;
+    JSON frame;
+    _json_reader_init_nested(state, &frame);
+    while (*pointer != '\0') {
+        if (*pointer != '/') {
             return JsonError_invalid;
+        }
+        size_t size;
+        JsonError err = JsonError_ok;
+        pointer = _json_pointer_next(pointer + 1, token, sizeof(token), &size, &err);
+        if (pointer == NULL) { return err; }
+        _TokenType open;
+        err = _json_parser_peek_token(&frame, stream, &open);
+        if (err != JsonError_ok) { return err; }
+        switch (open) {
+            case _TokenType_object_open: {
+                JsonKeyTable table;
+                table._keys = keys;
+                table._count = 1;
+                err = _json_parser_read_token(&frame, stream, &open);
+                if (err != JsonError_ok) { return err; }
+                frame._element_count = 0;
+                for (;;) {
+                    int key_id;
+                    err = json_reader_read_object_key(&frame, &table, &key_id, NULL);
+                    if (err != JsonError_ok) { return err; }
+                    if (key_id == 0) {
+                        break;
+                    }
+                    err = json_reader_skip_value(&frame);
+                    if (err != JsonError_ok) { return err; }
+                }
+                }
+                break;
+            case _TokenType_array_open: {
+                size_t index;
+                if (!_json_pointer_index(token, size, &index)) {
+                    return JsonError_not_found;
+                }
+                err = _json_parser_read_token(&frame, stream, &open);
+                if (err != JsonError_ok) { return err; }
+                frame._element_count = 0;
+                for (size_t i = 0; ; ++i) {
+                    err = json_reader_read_array(&frame, NULL);
+                    if (err != JsonError_ok) { return err; }
+                    if (i == index) {
+                        break;
+                    }
+                    err = json_reader_skip_value(&frame);
+                    if (err != JsonError_ok) { return err; }
+                }
+                }
+                break;
+            case _TokenType_string_open:
+            case _TokenType_number:
+            case _TokenType_bool_false:
+            case _TokenType_bool_true:
+            case _TokenType_null_value:
+                return JsonError_type_mismatch;
+            default:
+                return JsonError_invalid;
+        }
     }
-    state->_element_count++;
-    if (value) {
-        err = json_reader_peek_value(state, value);
-        return err;
+    _json_parser_init(state);
+    return JsonError_ok;
+}
+
+struct _JsonProjectionNode {
+    size_t _index;
+    int _path;
+    int _first;
+    int _count;
+};
+
+
+typedef struct {
+    const char* _segments;
+    int _depth;
+    int _pointer;
+} _JsonProjectionPath;
+
+
+/* Bounds the trie nodes by the number of reference tokens, plus the
+   root, and the decoded tokens by the pointer lengths. */
+static size_t
+_json_projection_bounds(const char* const* pointers, int count, size_t* segments) {
+    size_t n = 1;
+    size_t bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        for (const char* p = pointers[i]; *p != '\0'; ++p) {
+            n += *p == '/';
+        }
+        bytes += strlen(pointers[i]);
+    }
+    *segments = n;
+    return sizeof(void*) + n * (sizeof(struct _JsonProjectionNode) + sizeof(char*)) +
+        count * sizeof(_JsonProjectionPath) + bytes;
+}
+
+
+/* Storage needed by json_projection_init for these pointers. */
+PVJDEF size_t
+json_projection_storage_size(const char* const* pointers, int count) {
+    size_t segments;
+    return _json_projection_bounds(pointers, count, &segments);
+}
+
+
+static const char*
+_json_projection_segment(const _JsonProjectionPath* path, int depth) {
+    const char* s = path->_segments;
+    for (int i = 0; i < depth; ++i) {
+        s += strlen(s) + 1;
+    }
+    return s;
+}
+
+
+static int
+_json_projection_compare(const _JsonProjectionPath* a, const _JsonProjectionPath* b) {
+    const char* x = a->_segments;
+    const char* y = b->_segments;
+    int depth = a->_depth < b->_depth ? a->_depth : b->_depth;
+    for (int i = 0; i < depth; ++i) {
+        int c = strcmp(x, y);
+        if (c != 0) {
+            return c;
+        }
+        x += strlen(x) + 1;
+        y += strlen(y) + 1;
+    }
+    return a->_depth - b->_depth;
+}
+
+
+/* Compiles JSON Pointers into a trie laid out breadth first, so the
+   children of a node are contiguous and sorted by key, ready to serve
+   as a JsonKeyTable. Size the storage with json_projection_storage_size.
+   No pointer may be a prefix of another, since a matched value is
+   handed over whole. */
+PVJDEF JsonError
+json_projection_init(JsonProjection* projection, const char* const* pointers, int count, void* storage, size_t storage_size) {
+    size_t segments;
+    if (storage_size < _json_projection_bounds(pointers, count, &segments)) {
+        return JsonError_bufsize;
+    }
+    uintptr_t base = ((uintptr_t) storage + sizeof(void*) - 1) & ~(uintptr_t) (sizeof(void*) - 1);
+    struct _JsonProjectionNode* nodes = (struct _JsonProjectionNode*) base;
+    const char** keys = (const char**) (nodes + segments);
+    _JsonProjectionPath* paths = (_JsonProjectionPath*) (keys + segments);
+    char* strings = (char*) (paths + count);
+    char* strings_end = (char*) storage + storage_size;
+
+    for (int i = 0; i < count; ++i) {
+        const char* pointer = pointers[i];
+        _JsonProjectionPath path;
+        path._segments = strings;
+        path._depth = 0;
+        path._pointer = i;
+        while (*pointer != '\0') {
+            if (*pointer != '/') {
+                return JsonError_invalid;
+            }
+            if (++path._depth > PAIV_JSON_MAX_DEPTH) {
+                return JsonError_depth;
+            }
+            size_t size;
+            JsonError err = JsonError_ok;
+            pointer = _json_pointer_next(pointer + 1, strings, strings_end - strings, &size, &err);
+            if (pointer == NULL) { return err; }
+            strings += size + 1;
+        }
+        int j = i;
+        for (; j > 0 && _json_projection_compare(&paths[j - 1], &path) > 0; --j) {
+            paths[j] = paths[j - 1];
+        }
+        paths[j] = path;
+    }
+
+    /* a node holds its range of paths until its children are made */
+    int node_count = 1;
+    nodes[0]._index = SIZE_MAX;
+    nodes[0]._first = 0;
+    nodes[0]._count = count;
+    keys[0] = "";
+    int level_end = 1;
+    int depth = 0;
+    for (int i = 0; i < node_count; ++i) {
+        if (i == level_end) {
+            level_end = node_count;
+            depth++;
+        }
+        struct _JsonProjectionNode* node = &nodes[i];
+        int lo = node->_first;
+        int hi = lo + node->_count;
+        node->_path = -1;
+        node->_first = node_count;
+        node->_count = 0;
+        if (lo != hi && paths[lo]._depth == depth) {
+            if (hi - lo > 1) {
+                return JsonError_invalid;
+            }
+            node->_path = paths[lo]._pointer;
+            continue;
+        }
+        while (lo < hi) {
+            const char* key = _json_projection_segment(&paths[lo], depth);
+            int k = lo + 1;
+            while (k < hi && strcmp(_json_projection_segment(&paths[k], depth), key) == 0) {
+                k++;
+            }
+            struct _JsonProjectionNode* child = &nodes[node_count];
+            keys[node_count] = key;
+            if (!_json_pointer_index(key, strlen(key), &child->_index)) {
+                child->_index = SIZE_MAX;
+            }
+            child->_first = lo;
+            child->_count = k - lo;
+            node_count++;
+            node->_count++;
+            lo = k;
+        }
     }
+    projection->_nodes = nodes;
+    projection->_keys = keys;
+    projection->_count = node_count;
     return JsonError_ok;
 }
 
 
+/* Reads the next value once, handing each value at a projection path to
+   callback and skipping everything else. A container is left as soon
+   as all of its wanted members have been seen. */
 PVJDEF JsonError
-json_reader_open_array(JSON* state, JSON* array) {
+json_reader_project(JSON* state, const JsonProjection* projection, JsonProjectionFunc callback, void* user_data) {
+    int trie[PAIV_JSON_MAX_DEPTH];
+    int remaining[PAIV_JSON_MAX_DEPTH];
+    size_t elements[PAIV_JSON_MAX_DEPTH];
+    const struct _JsonProjectionNode* nodes = projection->_nodes;
+    JsonStream* stream = state->_stream;
+    if (nodes[0]._path >= 0) {
+        return callback(user_data, nodes[0]._path, state);
+    }
+    JSON frame;
+    _json_reader_init_nested(state, &frame);
     _TokenType token;
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
+    JsonError err = _json_parser_peek_token(&frame, stream, &token);
+    if (err != JsonError_ok) { return err; }
+    if ((token != _TokenType_object_open && token != _TokenType_array_open) || nodes[0]._count == 0) {
+        return json_reader_skip_value(state);
+    }
+    int depth = 0;
+    int node = 0;
+    for (;;) {
+        /* node is a container value that is next in the stream */
+        err = _json_parser_read_token(&frame, stream, &token);
+        if (err != JsonError_ok) { return err; }
+        trie[depth] = token == _TokenType_object_open ? node : ~node;
+        remaining[depth] = nodes[node]._count;
+        elements[depth] = 0;
+        depth++;
+        frame._element_count = 0;
+        for (;;) {
+            int top = depth - 1;
+            const struct _JsonProjectionNode* parent = &nodes[trie[top] < 0 ? ~trie[top] : trie[top]];
+            node = -1;
+            if (remaining[top] == 0) {
+                err = _json_parser_skip_container(stream);
+                if (err != JsonError_ok) { return err; }
+                err = JsonError_not_found;
+            }
+            else if (trie[top] >= 0) {
+                JsonKeyTable table;
+                table._keys = projection->_keys + parent->_first;
+                table._count = parent->_count;
+                int key_id;
+                err = json_reader_read_object_key(&frame, &table, &key_id, NULL);
+                if (err == JsonError_ok && key_id >= 0) {
+                    node = parent->_first + key_id;
+                }
+            }
+            else {
+                err = json_reader_read_array(&frame, NULL);
+                size_t element = elements[top]++;
+                for (int i = parent->_first; i < parent->_first + parent->_count; ++i) {
+                    if (nodes[i]._index == element) {
+                        node = i;
+                        break;
+                    }
+                }
+            }
+            if (err == JsonError_not_found) {
+                if (--depth == 0) {
+                    return JsonError_ok;
+                }
+                frame._element_count = 1;
+                continue;
+            }
+            if (err != JsonError_ok) { return err; }
+            if (node < 0) {
+                err = json_reader_skip_value(&frame);
+                if (err != JsonError_ok) { return err; }
+                continue;
+            }
+            remaining[top]--;
+            if (nodes[node]._path >= 0) {
+                err = callback(user_data, nodes[node]._path, &frame);
+                if (err != JsonError_ok) { return err; }
+                continue;
+            }
+            err = _json_parser_peek_token(&frame, stream, &token);
+            if (err != JsonError_ok) { return err; }
+            if (token == _TokenType_object_open || token == _TokenType_array_open) {
+                break;
+            }
+            err = json_reader_skip_value(&frame);
+            if (err != JsonError_ok) { return err; }
+        }
+    }
+}
+
+
+static JsonError
+_json_reader_consume_object_key(JSON* state) {
+    JsonError err = _json_reader_open_key(state);
     if (err != JsonError_ok) {
         return err;
     }
-    switch (token) {
-        case _TokenType_array_open:
-            break;
-        case _TokenType_null_value:
-            return JsonError_null;
-        default:
-            return JsonError_type_mismatch;
+    err = _json_parser_consume_string(state, state->_stream);
+    if (err != JsonError_ok) {
+        return err;
     }
-    err = json_reader_init(array, state->_file);
-    return err;
+    return _json_reader_close_key(state, NULL);
 }
 
 
-PVJDEF JsonError
-json_reader_read_array(JSON* state, JsonValueType* value) {
-    _TokenType token;
-    if (state->_element_count != 0) {
-        JsonError err = _json_parser_read_token(state, state->_file, &token);
+/* Consumes the rest of an array or object after its opening bracket.
+   Iterates with one bit per nesting level instead of recursing. */
+static JsonError
+_json_reader_consume_container(JSON* state, int is_object) {
+    unsigned char objects[(PAIV_JSON_MAX_DEPTH + 7) / 8];
+    JsonStream* stream = state->_stream;
+    JSON frame;
+    _json_reader_init_nested(state, &frame);
+    objects[0] = is_object;
+    int depth = 1;
+    for (;;) {
+        int top = depth - 1;
+        JsonError err;
+        if ((objects[top >> 3] >> (top & 7)) & 1) {
+            err = _json_reader_consume_object_key(&frame);
+        }
+        else {
+            err = json_reader_read_array(&frame, NULL);
+        }
+        if (err == JsonError_not_found) {
+            if (--depth == 0) {
+                return JsonError_ok;
+            }
+            frame._element_count = 1;
+            continue;
+        }
+        if (err != JsonError_ok) { return err; }
+        _TokenType token;
+        err = _json_parser_peek_token(&frame, stream, &token);
         if (err != JsonError_ok) { return err; }
         switch (token) {
-            case _TokenType_array_close:
-                return JsonError_not_found;
-            case _TokenType_value_separator:
+            case _TokenType_array_open:
+            case _TokenType_object_open:
+                if (depth == stream->_max_depth) {
+                    return JsonError_depth;
+                }
+                err = _json_parser_read_token(&frame, stream, &token);
+                if (err != JsonError_ok) { return err; }
+                if (token == _TokenType_object_open) {
+                    objects[depth >> 3] |= 1 << (depth & 7);
+                }
+                else {
+                    objects[depth >> 3] &= ~(1 << (depth & 7));
+                }
+                depth++;
+                frame._element_count = 0;
                 break;
             default:
-                return JsonError_invalid;
+                err = json_reader_consume_value(&frame);
+                if (err != JsonError_ok) { return err; }
+                break;
         }
     }
-    JsonError err = _json_parser_peek_token(state, state->_file, &token);
+}
+
+
+PVJDEF JsonError
+json_reader_peek_value(JSON* state, JsonValueType* value) {
+    _TokenType token;
+    JsonError err = _json_parser_peek_token(state, state->_stream, &token);
     if (err != JsonError_ok) { return err; }
     switch (token) {
         case _TokenType_bool_false:
-            if (value) { *value = JsonValueType_false; }
+            *value = JsonValueType_false;
             break;
         case _TokenType_bool_true:
-            if (value) { *value = JsonValueType_true; }
+            *value = JsonValueType_true;
             break;
         case _TokenType_array_open:
-            if (value) { *value = JsonValueType_array; }
+            *value = JsonValueType_array;
             break;
         case _TokenType_object_open:
-            if (value) { *value = JsonValueType_object; }
+            *value = JsonValueType_object;
             break;
         case _TokenType_string_open:
-            if (value) { *value = JsonValueType_string; }
+            *value = JsonValueType_string;
             break;
         case _TokenType_number:
-            if (value) { *value = JsonValueType_number; }
+            *value = JsonValueType_number;
             break;
         case _TokenType_null_value:
-            if (value) { *value = JsonValueType_null; }
+            *value = JsonValueType_null;
             break;
-        case _TokenType_array_close:
-            if (state->_element_count != 0) {
-                return JsonError_invalid;
-            }
-            _json_parser_read_token(state, state->_file, &token);
-            return JsonError_not_found;
-        case _TokenType_object_close:
-        case _TokenType_key_separator:
-        case _TokenType_value_separator:
-        case _TokenType_string_close:
-        case _TokenType_invalid:
+        default:
             return JsonError_invalid;
     }
-    state->_element_count++;
     return JsonError_ok;
 }
 
 
-static JsonError
-_json_reader_read_number(JSON* state, PAIV_JSON_NUMBER_BACKEND_TYPE* value, PAIV_JSON_NUMBER_BACKEND_TYPE* exponent) {
-    _TokenType token;
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) {
-        return err;
+enum {
+    _JsonNodeFlag_integer = 1,
+};
+
+
+/* Lays out the arena: an intern table of about 1/32 of its size, then
+   the node array. Fails with JsonError_bufsize when not even the table
+   and one node fit. */
+PVJDEF JsonError
+json_document_init(JsonDocument* document, void* arena, size_t arena_size) {
+    uintptr_t base = (uintptr_t) arena;
+    uintptr_t aligned = (base + sizeof(void*) - 1) & ~(uintptr_t) (sizeof(void*) - 1);
+    if (arena_size < aligned - base) {
+        return JsonError_bufsize;
     }
-    switch (token) {
-        case _TokenType_number:
-            break;
-        case _TokenType_null_value:
-            return JsonError_null;
-        default:
-            return JsonError_type_mismatch;
+    size_t size = arena_size - (aligned - base);
+    if (size > UINT32_MAX) {
+        size = UINT32_MAX;
     }
-    err = _json_parser_read_number(state, state->_file, value, exponent);
-    return err;
+    size_t slots = 16;
+    while (slots < 65536 && slots * 2 * 32 * sizeof(char*) <= size) {
+        slots *= 2;
+    }
+    if (size < slots * sizeof(char*) + sizeof(JsonNode)) {
+        return JsonError_bufsize;
+    }
+    document->_keys = (const char**) aligned;
+    document->_key_mask = slots - 1;
+    document->_nodes = (JsonNode*) (aligned + slots * sizeof(char*));
+    document->_end = (char*) aligned + size;
+    json_document_reset(document);
+    return JsonError_ok;
 }
 
 
-PVJDEF JsonError
-json_reader_read_numberi(JSON* state, int* value) {
-    PAIV_JSON_NUMBER_BACKEND_TYPE signi, power;
-    JsonError err = _json_reader_read_number(state, &signi, &power);
-    if (err != JsonError_ok) { return err; }
-    if (power == 0) {
-        *value = signi;
+PVJDEF void
+json_document_reset(JsonDocument* document) {
+    memset(document->_keys, 0, (document->_key_mask + 1) * sizeof(char*));
+    document->_key_count = 0;
+    document->_node_count = 0;
+    document->_strings = document->_end;
+}
+
+
+/* Bytes of the arena taken by nodes and strings. */
+PVJDEF size_t
+json_document_used(const JsonDocument* document) {
+    return document->_node_count * sizeof(JsonNode) + (document->_end - document->_strings);
+}
+
+
+static JsonNode*
+_json_document_push(JsonDocument* document) {
+    JsonNode* node = document->_nodes + document->_node_count;
+    if ((char*) (node + 1) > document->_strings) {
+        return NULL;
     }
-    else {
-        *value = signi * pow(10, power);
+    document->_node_count++;
+    node->_flags = 0;
+    node->_size = 0;
+    node->_next = 0;
+    node->_key_size = 0;
+    node->_key = NULL;
+    return node;
+}
+
+
+/* Free space between the nodes and the strings, less one node, used
+   to decode strings that cannot be borrowed from the source. */
+static char*
+_json_document_scratch(JsonDocument* document, size_t* size) {
+    char* p = (char*) (document->_nodes + document->_node_count + 1);
+    *size = p < document->_strings ? (size_t) (document->_strings - p) : 0;
+    return p;
+}
+
+
+/* Copies size bytes and a terminating NUL below the strings, plus
+   extra bytes before them. The source may be the scratch area. */
+static char*
+_json_document_store(JsonDocument* document, const char* data, size_t size, size_t extra) {
+    char* start = (char*) (document->_nodes + document->_node_count);
+    if ((size_t) (document->_strings - start) < size + 1 + extra) {
+        return NULL;
     }
-    return JsonError_ok;
+    char* p = document->_strings - size - 1;
+    memmove(p, data, size);
+    p[size] = '\0';
+    document->_strings = p - extra;
+    return p;
 }
 
 
-PVJDEF JsonError
-json_reader_read_numberl(JSON* state, long* value) {
-    PAIV_JSON_NUMBER_BACKEND_TYPE signi, power;
-    JsonError err = _json_reader_read_number(state, &signi, &power);
-    if (err != JsonError_ok) { return err; }
-    if (power == 0) {
-        *value = signi;
+/* Stores a key once per document; keys are preceded by their length.
+   Past 3/4 load the table stops growing and new keys are stored as is. */
+static const char*
+_json_document_intern(JsonDocument* document, const char* key, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ (unsigned char) key[i]) * 16777619u;
     }
-    else {
-        *value = signi * pow(10, power);
+    size_t mask = document->_key_mask;
+    size_t slot = hash & mask;
+    for (const char* entry; (entry = document->_keys[slot]) != NULL; slot = (slot + 1) & mask) {
+        uint32_t n;
+        memcpy(&n, entry - sizeof(n), sizeof(n));
+        if (n == size && memcmp(entry, key, size) == 0) {
+            return entry;
+        }
+    }
+    uint32_t n = (uint32_t) size;
+    char* entry = _json_document_store(document, key, size, sizeof(n));
+    if (entry == NULL) {
+        return NULL;
+    }
+    memcpy(entry - sizeof(n), &n, sizeof(n));
+    if (document->_key_count * 4 < (mask + 1) * 3) {
+        document->_keys[slot] = entry;
+        document->_key_count++;
+    }
+    return entry;
+}
+
+
+/* Reads a scalar into node, or the opening token of a container. */
+static JsonError
+_json_document_read_value(JsonDocument* document, JSON* state, JsonValueType type, JsonNode* node, _JsonNumber* number) {
+    node->_type = type;
+    switch (type) {
+        case JsonValueType_object:
+        case JsonValueType_array: {
+            _TokenType token;
+            return _json_parser_read_token(state, state->_stream, &token);
+            }
+        case JsonValueType_string: {
+            JsonStringView view;
+            size_t scratch_size;
+            char* scratch = _json_document_scratch(document, &scratch_size);
+            JsonError err = json_reader_read_string_view(state, &view, scratch_size, scratch);
+            if (err != JsonError_ok) { return err; }
+            if (view.size > UINT32_MAX) { return JsonError_range; }
+            const char* p = _json_document_store(document, view.data, view.size, 0);
+            if (p == NULL) { return JsonError_bufsize; }
+            node->_size = (uint32_t) view.size;
+            node->_value._string = p;
+            return JsonError_ok;
+            }
+        case JsonValueType_number: {
+            JsonError err = _json_reader_read_number(state, number);
+            if (err != JsonError_ok) { return err; }
+            if (number->exponent >= 0 && !number->truncated &&
+                _json_number_to_integer(number, &node->_value._integer) == JsonError_ok) {
+                node->_flags |= _JsonNodeFlag_integer;
+            }
+            else {
+                node->_value._real = _json_number_to_double(number);
+            }
+            return JsonError_ok;
+            }
+        case JsonValueType_true:
+        case JsonValueType_false: {
+            int value;
+            return json_reader_read_bool(state, &value);
+            }
+        case JsonValueType_null:
+            return json_reader_read_null(state);
+        default:
+            return JsonError_invalid;
     }
-    return JsonError_ok;
 }
 
 
+/* Parses the next value of the reader into the document and points
+   *root at its node. Values parsed earlier stay valid until reset.
+   Runs without recursion; nesting is bounded by the reader's depth limit. */
 PVJDEF JsonError
-json_reader_read_numberll(JSON* state, long long* value) {
-    PAIV_JSON_NUMBER_BACKEND_TYPE signi, power;
-    JsonError err = _json_reader_read_number(state, &signi, &power);
+json_document_parse(JsonDocument* document, JSON* state, const JsonNode** root) {
+    size_t parents[PAIV_JSON_MAX_DEPTH];
+    _JsonDecimal decimal;
+    _JsonNumber number;
+    number.decimal = &decimal;
+    JsonValueType type;
+    JsonError err = json_reader_peek_value(state, &type);
     if (err != JsonError_ok) { return err; }
-    if (power == 0) {
-        *value = signi;
+    JsonNode* node = _json_document_push(document);
+    if (node == NULL) { return JsonError_bufsize; }
+    size_t first = document->_node_count - 1;
+    err = _json_document_read_value(document, state, type, node, &number);
+    if (err != JsonError_ok) { return err; }
+    *root = node;
+    if (type != JsonValueType_object && type != JsonValueType_array) {
+        return JsonError_ok;
     }
-    else {
-        *value = signi * powl(10, power);
+    JSON frame;
+    _json_reader_init_nested(state, &frame);
+    parents[0] = first;
+    int depth = 1;
+    for (;;) {
+        JsonNode* parent = document->_nodes + parents[depth - 1];
+        JsonStringView key;
+        if (parent->_type == JsonValueType_object) {
+            /* keys of source readers are decoded into free arena space
+               before the window moves on, and interned from there */
+            size_t scratch_size;
+            char* scratch = _json_document_scratch(document, &scratch_size);
+            err = json_reader_read_object_view(&frame, &key, scratch_size, scratch, &type);
+        }
+        else {
+            err = json_reader_read_array(&frame, &type);
+        }
+        if (err == JsonError_not_found) {
+            /* _next held the last child while the container was open */
+            parent->_next = 0;
+            if (--depth == 0) {
+                return JsonError_ok;
+            }
+            frame._element_count = 1;
+            continue;
+        }
+        if (err != JsonError_ok) { return err; }
+        const char* interned = NULL;
+        if (parent->_type == JsonValueType_object) {
+            if (key.size > UINT32_MAX) { return JsonError_range; }
+            interned = _json_document_intern(document, key.data, key.size);
+            if (interned == NULL) { return JsonError_bufsize; }
+        }
+        node = _json_document_push(document);
+        if (node == NULL) { return JsonError_bufsize; }
+        size_t index = node - document->_nodes;
+        if (interned != NULL) {
+            node->_key = interned;
+            node->_key_size = (uint32_t) key.size;
+        }
+        if (parent->_size != 0) {
+            size_t last = parents[depth - 1] + parent->_next;
+            document->_nodes[last]._next = (uint32_t) (index - last);
+        }
+        parent->_next = (uint32_t) (index - parents[depth - 1]);
+        parent->_size++;
+        if (type == JsonValueType_object || type == JsonValueType_array) {
+            if (depth == state->_stream->_max_depth) {
+                return JsonError_depth;
+            }
+            parents[depth++] = index;
+            frame._element_count = 0;
+        }
+        err = _json_document_read_value(document, &frame, type, node, &number);
+        if (err != JsonError_ok) { return err; }
     }
-    return JsonError_ok;
 }
 
-PVJDEF JsonError
-json_reader_read_numberf(JSON* state, float* value) {
-    PAIV_JSON_NUMBER_BACKEND_TYPE signi, power;
-    JsonError err = _json_reader_read_number(state, &signi, &power);
-    if (err != JsonError_ok) { return err; }
-    *value = signi * powf(10, power);
-    return JsonError_ok;
+
+PVJDEF JsonValueType
+json_node_type(const JsonNode* node) {
+    return (JsonValueType) node->_type;
 }
 
 
-PVJDEF JsonError
-json_reader_read_numberd(JSON* state, double* value) {
-    PAIV_JSON_NUMBER_BACKEND_TYPE signi, power;
-    JsonError err = _json_reader_read_number(state, &signi, &power);
-    if (err != JsonError_ok) { return err; }
-    *value = signi * pow(10, power);
-    return JsonError_ok;
+/* Number of children of a container, or bytes of a string. */
+PVJDEF size_t
+json_node_size(const JsonNode* node) {
+    return node->_size;
 }
 
 
-PVJDEF JsonError
-json_reader_read_numberld(JSON* state, long double* value) {
-    PAIV_JSON_NUMBER_BACKEND_TYPE signi, power;
-    JsonError err = _json_reader_read_number(state, &signi, &power);
-    if (err != JsonError_ok) { return err; }
-    *value = signi * powl(10, power);
-    return JsonError_ok;
+PVJDEF const JsonNode*
+json_node_child(const JsonNode* node) {
+    return node->_size != 0 && (node->_type == JsonValueType_object || node->_type == JsonValueType_array) ? node + 1 : NULL;
 }
 
 
-PVJDEF JsonError
-json_reader_read_string(JSON* state, size_t* buf_size, char* buf) {
-    _TokenType token;
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) {
-        return err;
+PVJDEF const JsonNode*
+json_node_next(const JsonNode* node) {
+    return node->_next != 0 ? node + node->_next : NULL;
+}
+
+
+PVJDEF const JsonNode*
+json_node_find(const JsonNode* object, const char* key) {
+    if (object->_type != JsonValueType_object) {
+        return NULL;
     }
-    switch (token) {
-        case _TokenType_string_open:
-            break;
-        case _TokenType_null_value:
-            return JsonError_null;
-        default:
-            return JsonError_type_mismatch;
+    size_t size = strlen(key);
+    for (const JsonNode* child = json_node_child(object); child != NULL; child = json_node_next(child)) {
+        if (child->_key_size == size && memcmp(child->_key, key, size) == 0) {
+            return child;
+        }
     }
-    err = _json_parser_read_string(state, state->_file, buf_size, buf);
-    return err;
+    return NULL;
 }
 
 
-PVJDEF JsonError
-json_reader_resume_string(JSON* state, size_t* buf_size, char* buf) {
-    JsonError err = _json_parser_read_string(state, state->_file, buf_size, buf);
-    return err;
+/* Key of an object member, NUL-terminated; NULL for other nodes. */
+PVJDEF const char*
+json_node_key(const JsonNode* node, size_t* key_size) {
+    if (key_size != NULL) {
+        *key_size = node->_key_size;
+    }
+    return node->_key;
 }
 
 
 PVJDEF JsonError
-json_reader_read_bool(JSON* state, int* value) {
-    _TokenType token;
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) {
-        return err;
-    }
-    switch (token) {
-        case _TokenType_bool_false:
-            *value = 0;
-            break;
-        case _TokenType_bool_true:
-            *value = 1;
-            break;
-        case _TokenType_null_value:
+json_node_string(const JsonNode* node, const char** value, size_t* size) {
+    switch (node->_type) {
+        case JsonValueType_string:
+            *value = node->_value._string;
+            if (size != NULL) {
+                *size = node->_size;
+            }
+            return JsonError_ok;
+        case JsonValueType_null:
             return JsonError_null;
-        case _TokenType_array_open:
-        case _TokenType_object_open:
-        case _TokenType_string_open:
-        case _TokenType_number:
-            return JsonError_type_mismatch;
         default:
-            return JsonError_invalid;
+            return JsonError_type_mismatch;
     }
-    return JsonError_ok;
 }
 
 
+/* Integers keep all 64 bits; other numbers are truncated like
+   json_reader_read_numberll. */
 PVJDEF JsonError
-json_reader_read_null(JSON* state) {
-    _TokenType token;
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) {
-        return err;
-    }
-    switch (token) {
-        case _TokenType_null_value:
-            break;
-        case _TokenType_bool_false:
-        case _TokenType_bool_true:
-        case _TokenType_array_open:
-        case _TokenType_object_open:
-        case _TokenType_string_open:
-        case _TokenType_number:
-            return JsonError_type_mismatch;
+json_node_numberll(const JsonNode* node, long long* value) {
+    switch (node->_type) {
+        case JsonValueType_number:
+            if (node->_flags & _JsonNodeFlag_integer) {
+                *value = node->_value._integer;
+                return JsonError_ok;
+            }
+            if (!(node->_value._real > -9223372036854775809.0 && node->_value._real < 9223372036854775808.0)) {
+                return JsonError_range;
+            }
+            *value = (long long) node->_value._real;
+            return JsonError_ok;
+        case JsonValueType_null:
+            return JsonError_null;
         default:
-            return JsonError_invalid;
+            return JsonError_type_mismatch;
     }
-    return JsonError_ok;
 }
 
 
-static JsonError _json_reader_consume_array(JSON* state);
-static JsonError _json_reader_consume_object(JSON* state);
-
-
 PVJDEF JsonError
-json_reader_consume_value(JSON* state) {
-    _TokenType token;
-    JsonError err = _json_parser_peek_token(state, state->_file, &token);
-    if (err != JsonError_ok) {
-        return err;
-    }
-    switch (token) {
-        case _TokenType_null_value:
-        case _TokenType_bool_false:
-        case _TokenType_bool_true:
-            err = _json_parser_read_token(state, state->_file, &token);
-            return err;
-        case _TokenType_string_open: {
-            err = _json_parser_read_token(state, state->_file, &token);
-            if (err != JsonError_ok) { return err; }
-            err = _json_parser_consume_string(state, state->_file);
-            return err;
+json_node_numberd(const JsonNode* node, double* value) {
+    switch (node->_type) {
+        case JsonValueType_number:
+            if (node->_flags & _JsonNodeFlag_integer) {
+                *value = (double) node->_value._integer;
             }
-        case _TokenType_number: {
-            long long value, exponent;
-            err = _json_parser_read_number(state, state->_file, &value, &exponent);
-            return err;
+            else {
+                *value = node->_value._real;
             }
-        case _TokenType_array_open:
-            err = _json_reader_consume_array(state);
-            return err;
-        case _TokenType_object_open:
-            err = _json_reader_consume_object(state);
-            return err;
+            return JsonError_ok;
+        case JsonValueType_null:
+            return JsonError_null;
         default:
-            return JsonError_invalid;
+            return JsonError_type_mismatch;
     }
 }
 
 
-static JsonError
-_json_reader_consume_array(JSON* state) {
-    JSON array;
-    JsonError err = json_reader_open_array(state, &array);
+PVJDEF JsonError
+json_node_bool(const JsonNode* node, int* value) {
+    switch (node->_type) {
+        case JsonValueType_true:
+            *value = 1;
+            return JsonError_ok;
+        case JsonValueType_false:
+            *value = 0;
+            return JsonError_ok;
+        case JsonValueType_null:
+            return JsonError_null;
+        default:
+            return JsonError_type_mismatch;
+    }
+}
+
+
+PVJDEF JsonError
+json_writer_init(JSON* state, FILE* file) {
+    _json_stream_init(state, file, NULL, 0, NULL, NULL, NULL);
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_writer_init_unlocked(JSON* state, FILE* file) {
+    JsonError err = json_writer_init(state, file);
     if (err != JsonError_ok) { return err; }
-    for (;;) {
-        err = json_reader_read_array(&array, NULL);
-        if (err == JsonError_not_found) { break; }
-        if (err != JsonError_ok) { return err; }
-        err = json_reader_consume_value(&array);
-        if (err != JsonError_ok) { return err; }
-    }
+#if PAIV_JSON_POSIX
+    flockfile(file);
+    state->_stream->_flags |= _JsonStreamFlag_unlocked;
+#endif
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_writer_init_buffer(JSON* state, char* buf, size_t buf_size, JsonFlushFunc flush, void* user_data) {
+    _json_stream_init(state, NULL, buf, buf_size, NULL, flush, user_data);
     return JsonError_ok;
 }
 
 
 static JsonError
-_json_reader_consume_object_key(JSON* state) {
-    _TokenType token;
-    if (state->_element_count != 0) {
-        JsonError err = _json_parser_read_token(state, state->_file, &token);
-        if (err != JsonError_ok) { return err; }
-        switch (token) {
-            case _TokenType_object_close:
-                return JsonError_not_found;
-            case _TokenType_value_separator:
-                break;
-            default:
-                return JsonError_invalid;
-        }
+_json_stream_flush(JsonStream* stream) {
+    if (stream->_file != NULL) {
+        if (fflush(stream->_file) != 0) { return JsonError_write; }
+        return JsonError_ok;
     }
-    JsonError err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) { return err; }
-    switch (token) {
-        case _TokenType_string_open:
-            break;
-        case _TokenType_object_close:
-            if (state->_element_count != 0) {
-                return JsonError_invalid;
-            }
-            return JsonError_not_found;
-        default:
-            return JsonError_invalid;
+    size_t size = stream->_ptr - stream->_head;
+    if (size == 0) {
+        return JsonError_ok;
     }
-    err = _json_parser_consume_string(state, state->_file);
-    if (err != JsonError_ok) {
-        return err;
+    if (stream->_flush == NULL) {
+        return JsonError_bufsize;
     }
-    err = _json_parser_read_token(state, state->_file, &token);
-    if (err != JsonError_ok) {
-        return err;
+    JsonError err = stream->_flush(stream->_user_data, stream->_head, size);
+    if (err != JsonError_ok) { return err; }
+    stream->_ptr = stream->_head;
+    return JsonError_ok;
+}
+
+
+PVJDEF JsonError
+json_writer_flush(JSON* state) {
+    return _json_stream_flush(state->_stream);
+}
+
+
+PVJDEF size_t
+json_writer_buffer_size(JSON* state) {
+    JsonStream* stream = state->_stream;
+    return stream->_ptr - stream->_head;
+}
+
+
+PVJDEF JsonError
+json_writer_close(JSON* state) {
+    JsonStream* stream = state->_stream;
+    JsonError err = JsonError_ok;
+    if (stream->_file == NULL) {
+        err = _json_stream_flush(stream);
     }
-    switch (token) {
-        case _TokenType_key_separator:
-            break;
-        default:
-            return JsonError_invalid;
+#if PAIV_JSON_POSIX
+    if (stream->_flags & _JsonStreamFlag_unlocked) {
+        funlockfile(stream->_file);
     }
-    state->_element_count++;
-    return JsonError_ok;
+#endif
+    stream->_flags = 0;
+    return err;
 }
 
 
-static JsonError
-_json_reader_consume_object(JSON* state) {
-    JSON object;
-    JsonError err = json_reader_open_object(state, &object);
-    if (err != JsonError_ok) { return err; }
-    for (;;) {
-        err = _json_reader_consume_object_key(&object);
-        if (err == JsonError_not_found) { break; }
-        if (err != JsonError_ok) { return err; }
-        err = json_reader_consume_value(&object);
-        if (err != JsonError_ok) { return err; }
+static void
+_json_writer_init_nested(JSON* state, JSON* nested) {
+    nested->_stream = state->_stream;
+    nested->_element_count = 0;
+}
+
+
+static int
+_json_stream_overflow(JsonStream* stream, int c) {
+    if (stream->_file != NULL) {
+#if PAIV_JSON_POSIX
+        if (stream->_flags & _JsonStreamFlag_unlocked) {
+            return putc_unlocked(c, stream->_file);
+        }
+#endif
+        return fputc(c, stream->_file);
     }
-    return JsonError_ok;
+    if (_json_stream_flush(stream) != JsonError_ok || stream->_ptr == stream->_end) {
+        return EOF;
+    }
+    *(char*) stream->_ptr++ = c;
+    return (unsigned char) c;
 }
 
 
-PVJDEF JsonError
-json_reader_peek_value(JSON* state, JsonValueType* value) {
-    _TokenType token;
-    JsonError err = _json_parser_peek_token(state, state->_file, &token);
-    if (err != JsonError_ok) { return err; }
-    switch (token) {
-        case _TokenType_bool_false:
-            *value = JsonValueType_false;
-            break;
-        case _TokenType_bool_true:
-            *value = JsonValueType_true;
-            break;
-        case _TokenType_array_open:
-            *value = JsonValueType_array;
-            break;
-        case _TokenType_object_open:
-            *value = JsonValueType_object;
-            break;
-        case _TokenType_string_open:
-            *value = JsonValueType_string;
-            break;
-        case _TokenType_number:
-            *value = JsonValueType_number;
-            break;
-        case _TokenType_null_value:
-            *value = JsonValueType_null;
-            break;
-        default:
-            return JsonError_invalid;
+static int
+_json_stream_putc(JsonStream* stream, int c) {
+    if (stream->_ptr != stream->_end) {
+        *(char*) stream->_ptr++ = c;
+        return (unsigned char) c;
     }
-    return JsonError_ok;
+    return _json_stream_overflow(stream, c);
 }
 
 
-PVJDEF JsonError
-json_writer_init(JSON* state, FILE* file) {
-    state->_file = file;
-    state->_element_count = 0;
-    return JsonError_ok;
+static JsonError
+_json_stream_write(JsonStream* stream, const char* data, size_t size) {
+    FILE* fp = stream->_file;
+    if (fp != NULL) {
+#if PAIV_JSON_POSIX
+        if (stream->_flags & _JsonStreamFlag_unlocked) {
+            for (; size != 0; --size) {
+                if (putc_unlocked(*data++, fp) == EOF) { return JsonError_write; }
+            }
+            return JsonError_ok;
+        }
+#endif
+        if (size != 0 && fwrite(data, size, 1, fp) != 1) { return JsonError_write; }
+        return JsonError_ok;
+    }
+    for (;;) {
+        size_t space = stream->_end - stream->_ptr;
+        if (size <= space) {
+            memcpy((char*) stream->_ptr, data, size);
+            stream->_ptr += size;
+            return JsonError_ok;
+        }
+        if (stream->_flush == NULL) { return JsonError_write; }
+        memcpy((char*) stream->_ptr, data, space);
+        stream->_ptr += space;
+        data += space;
+        size -= space;
+        if (_json_stream_flush(stream) != JsonError_ok) { return JsonError_write; }
+        if (size >= (size_t) (stream->_end - stream->_head)) {
+            if (stream->_flush(stream->_user_data, data, size) != JsonError_ok) { return JsonError_write; }
+            return JsonError_ok;
+        }
+    }
 }
 
 
 PVJDEF JsonError
 json_writer_open_object(JSON* state, JSON* object) {
-    FILE* fp = state->_file;
-    if (fputc('{', fp) == EOF) { return JsonError_write; }
-    JsonError err = json_writer_init(object, fp);
-    return err;
+    JsonStream* stream = state->_stream;
+    if (_json_stream_putc(stream, '{') == EOF) { return JsonError_write; }
+    _json_writer_init_nested(state, object);
+    return JsonError_ok;
 }
 
 
 PVJDEF JsonError
 json_writer_close_object(JSON* state) {
-    FILE* fp = state->_file;
-    if (fputc('}', fp) == EOF) { return JsonError_write; }
+    JsonStream* stream = state->_stream;
+    if (_json_stream_putc(stream, '}') == EOF) { return JsonError_write; }
     return JsonError_ok;
 }
 
 
 PVJDEF JsonError
 json_writer_write_object_key_separator(JSON* state) {
-    FILE* fp = state->_file;
-    if (fputc(':', fp) == EOF) { return JsonError_write; }
+    JsonStream* stream = state->_stream;
+    if (_json_stream_putc(stream, ':') == EOF) { return JsonError_write; }
     return JsonError_ok;
 }
 
@@ -1277,8 +5476,8 @@ json_writer_write_object_key_separator(JSON* state) {
 PVJDEF JsonError
 json_writer_write_object_value_separator(JSON* state) {
     if (state->_element_count++ != 0) {
-        FILE* fp = state->_file;
-        if (fputc(',', fp) == EOF) { return JsonError_write; }
+        JsonStream* stream = state->_stream;
+        if (_json_stream_putc(stream, ',') == EOF) { return JsonError_write; }
     }
     return JsonError_ok;
 }
@@ -1286,17 +5485,17 @@ json_writer_write_object_value_separator(JSON* state) {
 
 PVJDEF JsonError
 json_writer_open_array(JSON* state, JSON* array) {
-    FILE* fp = state->_file;
-    if (fputc('[', fp) == EOF) { return JsonError_write; }
-    JsonError err = json_writer_init(array, fp);
-    return err;
+    JsonStream* stream = state->_stream;
+    if (_json_stream_putc(stream, '[') == EOF) { return JsonError_write; }
+    _json_writer_init_nested(state, array);
+    return JsonError_ok;
 }
 
 
 PVJDEF JsonError
 json_writer_close_array(JSON* state) {
-    FILE* fp = state->_file;
-    if (fputc(']', fp) == EOF) { return JsonError_write; }
+    JsonStream* stream = state->_stream;
+    if (_json_stream_putc(stream, ']') == EOF) { return JsonError_write; }
     return JsonError_ok;
 }
 
@@ -1304,130 +5503,462 @@ json_writer_close_array(JSON* state) {
 PVJDEF JsonError
 json_writer_write_array_value_separator(JSON* state) {
     if (state->_element_count++ != 0) {
-        FILE* fp = state->_file;
-        if (fputc(',', fp) == EOF) { return JsonError_write; }
+        JsonStream* stream = state->_stream;
+        if (_json_stream_putc(stream, ',') == EOF) { return JsonError_write; }
     }
     return JsonError_ok;
 }
 
 
+static const char _json_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+
+static int
+_json_count_digits(uint64_t x) {
+    int t = (64 - __builtin_clzll(x | 1)) * 1233 >> 12;
+    return t + ((x | 1) >= _json_pow10_u64[t]);
+}
+
+
+/* Writes the decimal digits of x, two per division. Returns the count. */
+static int
+_json_format_u64(char* out, uint64_t x) {
+    int n = _json_count_digits(x);
+    char* p = out + n;
+    while (x >= 100) {
+        uint64_t q = x / 100;
+        p -= 2;
+        memcpy(p, _json_digit_pairs + (x - q * 100) * 2, 2);
+        x = q;
+    }
+    if (x >= 10) {
+        memcpy(p - 2, _json_digit_pairs + x * 2, 2);
+    }
+    else {
+        p[-1] = '0' + x;
+    }
+    return n;
+}
+
+
+static JsonError
+_json_writer_write_integer(JsonStream* stream, long long value) {
+    char buf[24];
+    char* out = stream->_end - stream->_ptr >= 24 ? (char*) stream->_ptr : buf;
+    char* p = out;
+    uint64_t x = value;
+    if (value < 0) {
+        *p++ = '-';
+        x = 0 - x;
+    }
+    p += _json_format_u64(p, x);
+    if (out != buf) {
+        stream->_ptr = p;
+        return JsonError_ok;
+    }
+    return _json_stream_write(stream, buf, p - buf);
+}
+
+
+static uint64_t
+_json_round_to_odd(const uint64_t* g, uint64_t cp) {
+    uint64_t x0, y0;
+    uint64_t x1 = _json_umul128(g[1], cp, &x0);
+    uint64_t y1 = _json_umul128(g[0], cp, &y0);
+    uint64_t z = y0 + x1;
+    y1 += z < x1;
+    return y1 | (z > 1);
+}
+
+
+/* Schubfach: finds the shortest digits * 10^exp10 that rounds back to
+   c * 2^q, picking the closest one on ties in length. */
+static uint64_t
+_json_shortest_decimal(uint64_t c, int q, int lower_closer, int* exp10) {
+    int k = (q * 1262611 - (lower_closer ? 524031 : 0)) >> 22;
+    int h = q + ((-k * 1741647) >> 19) + 1;
+    const uint64_t* pow10 = _json_pow10_table[-k - _JSON_POW10_MIN];
+    /* the table is floor-rounded where not exact; this needs the ceiling */
+    uint64_t g[2] = { pow10[0], pow10[1] };
+    if (-k < -27 || -k > 55) {
+        g[1]++;
+        g[0] += g[1] == 0;
+    }
+    int even = (c & 1) == 0;
+    uint64_t vbl = _json_round_to_odd(g, (4 * c - 2 + lower_closer) << h);
+    uint64_t vb = _json_round_to_odd(g, (4 * c) << h);
+    uint64_t vbr = _json_round_to_odd(g, (4 * c + 2) << h);
+    uint64_t lower = vbl + !even;
+    uint64_t upper = vbr - !even;
+    uint64_t s = vb / 4;
+    if (s >= 10) {
+        uint64_t sp = s / 10;
+        int up_inside = lower <= 40 * sp;
+        int wp_inside = 40 * sp + 40 <= upper;
+        if (up_inside != wp_inside) {
+            *exp10 = k + 1;
+            return sp + wp_inside;
+        }
+    }
+    *exp10 = k;
+    int u_inside = lower <= 4 * s;
+    int w_inside = 4 * s + 4 <= upper;
+    if (u_inside != w_inside) {
+        return s + w_inside;
+    }
+    uint64_t mid = 4 * s + 2;
+    return s + (vb > mid || (vb == mid && (s & 1) != 0));
+}
+
+
+/* Lays out digits * 10^exp10 like %.<precision>g would, without
+   trailing zeros. Returns the number of bytes written, at most 32. */
+static int
+_json_format_decimal(char* out, int negative, uint64_t digits, int exp10, int precision) {
+    char d[20];
+    char* p = out;
+    if (negative) { *p++ = '-'; }
+    while (digits != 0 && digits % 10 == 0) {
+        digits /= 10;
+        exp10++;
+    }
+    int n = _json_format_u64(d, digits);
+    int x = exp10 + n - 1;
+    if (x >= -4 && x < precision) {
+        if (x < 0) {
+            *p++ = '0';
+            *p++ = '.';
+            for (int i = -1; i > x; --i) { *p++ = '0'; }
+            memcpy(p, d, n);
+            p += n;
+        }
+        else if (n <= x + 1) {
+            memcpy(p, d, n);
+            p += n;
+            for (int i = n; i <= x; ++i) { *p++ = '0'; }
+        }
+        else {
+            memcpy(p, d, x + 1);
+            p += x + 1;
+            *p++ = '.';
+            memcpy(p, d + x + 1, n - x - 1);
+            p += n - x - 1;
+        }
+    }
+    else {
+        *p++ = d[0];
+        if (n > 1) {
+            *p++ = '.';
+            memcpy(p, d + 1, n - 1);
+            p += n - 1;
+        }
+        *p++ = 'e';
+        *p++ = x < 0 ? '-' : '+';
+        if (x < 0) { x = -x; }
+        if (x >= 100) { *p++ = '0' + x / 100; }
+        *p++ = '0' + x / 10 % 10;
+        *p++ = '0' + x % 10;
+    }
+    return p - out;
+}
+
+
+static int
+_json_format_special(char* out, int negative, int nan) {
+    char* p = out;
+    if (negative && !nan) { *p++ = '-'; }
+    memcpy(p, nan ? "nan" : "inf", 3);
+    return p - out + 3;
+}
+
+
+static int
+_json_format_double(char* out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int negative = bits >> 63;
+    uint64_t m = bits & ((1ull << 52) - 1);
+    int e = (bits >> 52) & 0x7FF;
+    if (e == 0x7FF) {
+        return _json_format_special(out, negative, m != 0);
+    }
+    if (e == 0 && m == 0) {
+        return _json_format_decimal(out, negative, 0, 0, 17);
+    }
+    uint64_t c = e != 0 ? m | (1ull << 52) : m;
+    int q = e != 0 ? e - 1075 : -1074;
+    int exp10 = 0;
+    uint64_t digits;
+    if (q <= 0 && q > -53 && (c & ((1ull << -q) - 1)) == 0) {
+        digits = c >> -q;
+    }
+    else {
+        digits = _json_shortest_decimal(c, q, m == 0 && e > 1, &exp10);
+    }
+    return _json_format_decimal(out, negative, digits, exp10, 17);
+}
+
+
+static int
+_json_format_float(char* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int negative = bits >> 31;
+    uint64_t m = bits & ((1u << 23) - 1);
+    int e = (bits >> 23) & 0xFF;
+    if (e == 0xFF) {
+        return _json_format_special(out, negative, m != 0);
+    }
+    if (e == 0 && m == 0) {
+        return _json_format_decimal(out, negative, 0, 0, 9);
+    }
+    uint64_t c = e != 0 ? m | (1u << 23) : m;
+    int q = e != 0 ? e - 150 : -149;
+    int exp10 = 0;
+    uint64_t digits;
+    if (q <= 0 && q > -24 && (c & ((1ull << -q) - 1)) == 0) {
+        digits = c >> -q;
+    }
+    else {
+        digits = _json_shortest_decimal(c, q, m == 0 && e > 1, &exp10);
+    }
+    return _json_format_decimal(out, negative, digits, exp10, 9);
+}
+
+
+
 PVJDEF JsonError
 json_writer_write_numberi(JSON* state, int value) {
-    int n = fprintf(state->_file, "%d", value);
-    if (n < 0) { return JsonError_write; }
-    return JsonError_ok;
+    return _json_writer_write_integer(state->_stream, value);
 }
 
 
 PVJDEF JsonError
 json_writer_write_numberl(JSON* state, long value) {
-    int n = fprintf(state->_file, "%ld", value);
-    if (n < 0) { return JsonError_write; }
-    return JsonError_ok;
+    return _json_writer_write_integer(state->_stream, value);
 }
 
 
 PVJDEF JsonError
 json_writer_write_numberll(JSON* state, long long value) {
-    int n = fprintf(state->_file, "%lld", value);
-    if (n < 0) { return JsonError_write; }
-    return JsonError_ok;
+    return _json_writer_write_integer(state->_stream, value);
 }
 
 
 PVJDEF JsonError
 json_writer_write_numberf(JSON* state, float value) {
-    int n = fprintf(state->_file, "%.7g", value);
-    if (n < 0) { return JsonError_write; }
-    return JsonError_ok;
+    JsonStream* stream = state->_stream;
+    if (stream->_end - stream->_ptr >= 32) {
+        stream->_ptr += _json_format_float((char*) stream->_ptr, value);
+        return JsonError_ok;
+    }
+    char buf[32];
+    int n = _json_format_float(buf, value);
+    return _json_stream_write(stream, buf, n);
+}
+
+
+static JsonError
+_json_writer_write_double(JsonStream* stream, double value) {
+    if (stream->_end - stream->_ptr >= 32) {
+        stream->_ptr += _json_format_double((char*) stream->_ptr, value);
+        return JsonError_ok;
+    }
+    char buf[32];
+    int n = _json_format_double(buf, value);
+    return _json_stream_write(stream, buf, n);
 }
 
 
 PVJDEF JsonError
 json_writer_write_numberd(JSON* state, double value) {
-    int n = fprintf(state->_file, "%.16g", value);
-    if (n < 0) { return JsonError_write; }
-    return JsonError_ok;
+    return _json_writer_write_double(state->_stream, value);
 }
 
 
 PVJDEF JsonError
 json_writer_write_numberld(JSON* state, long double value) {
-    int n = fprintf(state->_file, "%.34Lg", value);
-    if (n < 0) { return JsonError_write; }
-    return JsonError_ok;
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), "%.34Lg", value);
+    if (n < 0 || n >= (int) sizeof(buf)) { return JsonError_write; }
+    return _json_stream_write(state->_stream, buf, n);
 }
 
 
-PVJDEF JsonError
-json_writer_write_string(JSON* state, const char* value) {
-    FILE* fp = state->_file;
+static size_t
+_json_escape_char(char* out, unsigned char c) {
+    static const char hex[] = "0123456789abcdef";
+    out[0] = '\\';
+    switch (c) {
+        case '\b':
+            out[1] = 'b';
+            return 2;
+        case '\t':
+            out[1] = 't';
+            return 2;
+        case '\n':
+            out[1] = 'n';
+            return 2;
+        case '\f':
+            out[1] = 'f';
+            return 2;
+        case '\r':
+            out[1] = 'r';
+            return 2;
+        case '"':
+        case '\\':
+            out[1] = c;
+            return 2;
+        default:
+            out[1] = 'u';
+            out[2] = '0';
+            out[3] = '0';
+            out[4] = hex[c >> 4];
+            out[5] = hex[c & 0xF];
+            return 6;
+    }
+}
+
+
+static JsonError
+_json_writer_write_string(JsonStream* stream, const char* value, size_t size) {
     const char* p = value;
-    if (fputc('"', fp) == EOF) { return JsonError_write; }
-    for (;; ++p) {
-        char c = *p;
-        if (c == '\0') { break; }
-        switch (c) {
-            case '\b':
-                fputc('\\', fp);
-                fputc('b', fp);
-                break;
-            case '\t':
-                fputc('\\', fp);
-                fputc('t', fp);
-                break;
-            case '\n':
-                fputc('\\', fp);
-                fputc('n', fp);
-                break;
-            case '\f':
-                fputc('\\', fp);
-                fputc('f', fp);
-                break;
-            case '\r':
-                fputc('\\', fp);
-                fputc('r', fp);
-                break;
-            case '"':
-                fputc('\\', fp);
-                fputc('"', fp);
-                break;
-            case '\\':
-                fputc('\\', fp);
-                fputc('\\', fp);
-                break;
-            default:
-                fputc(c, fp);
-                break;
-        }
+    const char* end = value + size;
+    if (_json_stream_putc(stream, '"') == EOF) { return JsonError_write; }
+    while (p != end) {
+        const char* q = _json_scan_string(p, end);
+        if (q != p && _json_stream_write(stream, p, q - p) != JsonError_ok) { return JsonError_write; }
+        if (q == end) { break; }
+        char escape[6];
+        size_t n = _json_escape_char(escape, *q);
+        if (_json_stream_write(stream, escape, n) != JsonError_ok) { return JsonError_write; }
+        p = q + 1;
     }
-    if (fputc('"', fp) == EOF) { return JsonError_write; }
+    if (_json_stream_putc(stream, '"') == EOF) { return JsonError_write; }
     return JsonError_ok;
 }
 
 
+PVJDEF JsonError
+json_writer_write_stringn(JSON* state, const char* value, size_t size) {
+    return _json_writer_write_string(state->_stream, value, size);
+}
+
+
+PVJDEF JsonError
+json_writer_write_string(JSON* state, const char* value) {
+    return json_writer_write_stringn(state, value, strlen(value));
+}
+
+
 PVJDEF JsonError
 json_writer_write_bool(JSON* state, int value) {
-    size_t n;
     if (value == 0) {
-        n = fwrite("false", 5, 1, state->_file);
-    }
-    else {
-        n = fwrite("true", 4, 1, state->_file);
+        return _json_stream_write(state->_stream, "false", 5);
     }
-    if (n != 1) { return JsonError_write; }
-    return JsonError_ok;
+    return _json_stream_write(state->_stream, "true", 4);
 }
 
 
 PVJDEF JsonError
 json_writer_write_null(JSON* state) {
-    size_t n = fwrite("null", 4, 1, state->_file);
-    if (n != 1) { return JsonError_write; }
+    return _json_stream_write(state->_stream, "null", 4);
+}
+
+
+/* Starts a line indented by depth levels of indent spaces. */
+static JsonError
+_json_writer_write_indent(JsonStream* stream, int indent, int depth) {
+    static const char spaces[] = "                                                                ";
+    if (_json_stream_putc(stream, '\n') == EOF) { return JsonError_write; }
+    for (size_t n = (size_t) indent * depth; n != 0; ) {
+        size_t k = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+        if (_json_stream_write(stream, spaces, k) != JsonError_ok) { return JsonError_write; }
+        n -= k;
+    }
     return JsonError_ok;
 }
 
 
+static JsonError
+_json_writer_write_scalar(JsonStream* stream, const JsonNode* node) {
+    switch (node->_type) {
+        case JsonValueType_string:
+            return _json_writer_write_string(stream, node->_value._string, node->_size);
+        case JsonValueType_number:
+            if (node->_flags & _JsonNodeFlag_integer) {
+                return _json_writer_write_integer(stream, node->_value._integer);
+            }
+            return _json_writer_write_double(stream, node->_value._real);
+        case JsonValueType_true:
+            return _json_stream_write(stream, "true", 4);
+        case JsonValueType_false:
+            return _json_stream_write(stream, "false", 5);
+        case JsonValueType_null:
+            return _json_stream_write(stream, "null", 4);
+        default:
+            return JsonError_invalid;
+    }
+}
+
+
+/* Writes a document node and everything under it in one pass over the
+   node array, without the per-value separator calls. A positive indent
+   puts each member on its own line; otherwise the output is compact. */
+PVJDEF JsonError
+json_writer_write_node(JSON* state, const JsonNode* node, int indent) {
+    uint32_t remaining[PAIV_JSON_MAX_DEPTH];
+    unsigned char objects[(PAIV_JSON_MAX_DEPTH + 7) / 8];
+    JsonStream* stream = state->_stream;
+    int depth = 0;
+    for (;; ++node) {
+        if (depth != 0 && node->_key != NULL) {
+            JsonError err = _json_writer_write_string(stream, node->_key, node->_key_size);
+            if (err != JsonError_ok) { return err; }
+            if (_json_stream_write(stream, ": ", indent > 0 ? 2 : 1) != JsonError_ok) { return JsonError_write; }
+        }
+        if (node->_type == JsonValueType_object || node->_type == JsonValueType_array) {
+            int is_object = node->_type == JsonValueType_object;
+            if (_json_stream_putc(stream, is_object ? '{' : '[') == EOF) { return JsonError_write; }
+            if (node->_size != 0) {
+                if (depth == PAIV_JSON_MAX_DEPTH) { return JsonError_depth; }
+                if (is_object) {
+                    objects[depth >> 3] |= 1 << (depth & 7);
+                }
+                else {
+                    objects[depth >> 3] &= ~(1 << (depth & 7));
+                }
+                remaining[depth++] = node->_size;
+                if (indent > 0 && _json_writer_write_indent(stream, indent, depth) != JsonError_ok) { return JsonError_write; }
+                continue;
+            }
+            if (_json_stream_putc(stream, is_object ? '}' : ']') == EOF) { return JsonError_write; }
+        }
+        else {
+            JsonError err = _json_writer_write_scalar(stream, node);
+            if (err != JsonError_ok) { return err; }
+        }
+        for (;;) {
+            if (depth == 0) {
+                return JsonError_ok;
+            }
+            if (--remaining[depth - 1] != 0) {
+                if (_json_stream_putc(stream, ',') == EOF) { return JsonError_write; }
+                if (indent > 0 && _json_writer_write_indent(stream, indent, depth) != JsonError_ok) { return JsonError_write; }
+                break;
+            }
+            depth--;
+            if (indent > 0 && _json_writer_write_indent(stream, indent, depth) != JsonError_ok) { return JsonError_write; }
+            int is_object = (objects[depth >> 3] >> (depth & 7)) & 1;
+            if (_json_stream_putc(stream, is_object ? '}' : ']') == EOF) { return JsonError_write; }
+        }
+    }
+}
+
+
 #endif /* PAIV_JSON_IMPLEMENTATION */
 
 
@@ -0,0 +1,598 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PAIV_JSON_IMPLEMENTATION
+#include "paiv_json.h"
+
+typedef size_t sz;
+typedef uint64_t u64;
+typedef double r64;
+typedef const char cs;
+
+
+static void
+fatal_perror(cs* context=nullptr) {
+    perror(context);
+    abort();
+}
+
+
+static void
+check_ok(JsonError err) {
+    if (err != JsonError_ok) {
+        fprintf(stderr, "! json error %d\n", err);
+        abort();
+    }
+}
+
+
+static r64
+now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+template<class Worker>
+static void
+bench(cs* name, sz bytes, int rounds, Worker worker) {
+    r64 best = 0;
+    for (int i = 0; i < rounds; ++i) {
+        r64 start = now_seconds();
+        worker();
+        r64 elapsed = now_seconds() - start;
+        if (i == 0 || elapsed < best) { best = elapsed; }
+    }
+    printf("%-32s %9.1f MB/s\n", name, bytes / best / 1e6);
+}
+
+
+static void
+write_document(JSON* writer, int count) {
+    JSON array;
+    check_ok(json_writer_open_array(writer, &array));
+    for (int i = 0; i < count; ++i) {
+        JSON object, tags;
+        char name[32];
+        snprintf(name, sizeof(name), "item %d", i);
+        check_ok(json_writer_write_array_value_separator(&array));
+        check_ok(json_writer_open_object(&array, &object));
+        check_ok(json_writer_write_object_value_separator(&object));
+        check_ok(json_writer_write_string(&object, "id"));
+        check_ok(json_writer_write_object_key_separator(&object));
+        check_ok(json_writer_write_numberi(&object, i));
+        check_ok(json_writer_write_object_value_separator(&object));
+        check_ok(json_writer_write_string(&object, "name"));
+        check_ok(json_writer_write_object_key_separator(&object));
+        check_ok(json_writer_write_string(&object, name));
+        check_ok(json_writer_write_object_value_separator(&object));
+        check_ok(json_writer_write_string(&object, "score"));
+        check_ok(json_writer_write_object_key_separator(&object));
+        check_ok(json_writer_write_numberd(&object, i * 0.25));
+        check_ok(json_writer_write_object_value_separator(&object));
+        check_ok(json_writer_write_string(&object, "tags"));
+        check_ok(json_writer_write_object_key_separator(&object));
+        check_ok(json_writer_open_array(&object, &tags));
+        check_ok(json_writer_write_array_value_separator(&tags));
+        check_ok(json_writer_write_string(&tags, "alpha"));
+        check_ok(json_writer_write_array_value_separator(&tags));
+        check_ok(json_writer_write_string(&tags, "beta"));
+        check_ok(json_writer_close_array(&tags));
+        check_ok(json_writer_write_object_value_separator(&object));
+        check_ok(json_writer_write_string(&object, "active"));
+        check_ok(json_writer_write_object_key_separator(&object));
+        check_ok(json_writer_write_bool(&object, i % 2));
+        check_ok(json_writer_close_object(&object));
+    }
+    check_ok(json_writer_close_array(&array));
+}
+
+
+static void
+bench_stdio_locking(int count) {
+    FILE* fp = tmpfile();
+    if (fp == nullptr) { fatal_perror("tmpfile"); }
+    JSON writer;
+    check_ok(json_writer_init(&writer, fp));
+    write_document(&writer, count);
+    sz size = ftell(fp);
+
+    bench("writer fputc", size, 3, [&] {
+        rewind(fp);
+        JSON writer;
+        check_ok(json_writer_init(&writer, fp));
+        write_document(&writer, count);
+        check_ok(json_writer_close(&writer));
+    });
+    bench("writer putc_unlocked", size, 3, [&] {
+        rewind(fp);
+        JSON writer;
+        check_ok(json_writer_init_unlocked(&writer, fp));
+        write_document(&writer, count);
+        check_ok(json_writer_close(&writer));
+    });
+    bench("reader fgetc", size, 3, [&] {
+        rewind(fp);
+        JSON reader;
+        check_ok(json_reader_init(&reader, fp));
+        check_ok(json_reader_consume_value(&reader));
+        check_ok(json_reader_close(&reader));
+    });
+    bench("reader getc_unlocked", size, 3, [&] {
+        rewind(fp);
+        JSON reader;
+        check_ok(json_reader_init_unlocked(&reader, fp));
+        check_ok(json_reader_consume_value(&reader));
+        check_ok(json_reader_close(&reader));
+    });
+
+    sz storage_size = json_reader_pipe_storage_size(1 << 16, 8);
+    void* storage = malloc(storage_size);
+    if (storage == nullptr) { fatal_perror("malloc"); }
+    bench("reader pipe", size, 3, [&] {
+        rewind(fp);
+        JSON reader;
+        check_ok(json_reader_init_pipe(&reader, fp, 1 << 16, storage, storage_size));
+        check_ok(json_reader_consume_value(&reader));
+        check_ok(json_reader_close(&reader));
+    });
+    free(storage);
+
+    fclose(fp);
+}
+
+
+static JsonError
+file_flush(void* user_data, cs* data, sz size) {
+    if (fwrite(data, size, 1, (FILE*) user_data) != 1) { return JsonError_write; }
+    return JsonError_ok;
+}
+
+
+static void
+bench_writer_buffer(int count) {
+    FILE* fp = tmpfile();
+    if (fp == nullptr) { fatal_perror("tmpfile"); }
+    static char buf[64 * 1024];
+    JSON writer;
+    check_ok(json_writer_init_buffer(&writer, buf, sizeof(buf), file_flush, fp));
+    write_document(&writer, count);
+    check_ok(json_writer_close(&writer));
+    sz size = ftell(fp);
+
+    bench("writer buffer", size, 3, [&] {
+        rewind(fp);
+        JSON writer;
+        check_ok(json_writer_init_buffer(&writer, buf, sizeof(buf), file_flush, fp));
+        write_document(&writer, count);
+        check_ok(json_writer_close(&writer));
+    });
+
+    fclose(fp);
+}
+
+
+static sz
+render_document(char* buf, sz buf_size, int count) {
+    JSON writer;
+    check_ok(json_writer_init_buffer(&writer, buf, buf_size, nullptr, nullptr));
+    write_document(&writer, count);
+    return json_writer_buffer_size(&writer);
+}
+
+
+static sz
+indent_document(char* out, cs* data, sz size, int indent) {
+    char* p = out;
+    int nesting = 0;
+    int in_string = 0;
+    for (sz i = 0; i < size; ++i) {
+        char c = data[i];
+        if (in_string) {
+            *p++ = c;
+            if (c == '\\') { *p++ = data[++i]; }
+            else if (c == '"') { in_string = 0; }
+            continue;
+        }
+        switch (c) {
+            case '"':
+                in_string = 1;
+                *p++ = c;
+                break;
+            case '[':
+            case '{':
+                *p++ = c;
+                nesting++;
+                *p++ = '\n';
+                for (int j = 0; j < nesting * indent; ++j) { *p++ = ' '; }
+                break;
+            case ']':
+            case '}':
+                nesting--;
+                *p++ = '\n';
+                for (int j = 0; j < nesting * indent; ++j) { *p++ = ' '; }
+                *p++ = c;
+                break;
+            case ',':
+                *p++ = c;
+                *p++ = '\n';
+                for (int j = 0; j < nesting * indent; ++j) { *p++ = ' '; }
+                break;
+            case ':':
+                *p++ = c;
+                *p++ = ' ';
+                break;
+            default:
+                *p++ = c;
+                break;
+        }
+    }
+    return p - out;
+}
+
+
+static void
+bench_whitespace(int count) {
+    sz cap = (sz) count * 512;
+    char* compact = (char*) malloc(cap);
+    char* indented = (char*) malloc(cap * 4);
+    if (compact == nullptr || indented == nullptr) { fatal_perror("malloc"); }
+    sz compact_size = render_document(compact, cap, count);
+    sz indented_size = indent_document(indented, compact, compact_size, 4);
+
+    bench("reader buffer compact", compact_size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, compact, compact_size));
+        check_ok(json_reader_consume_value(&reader));
+    });
+    bench("reader buffer indented", indented_size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, indented, indented_size));
+        check_ok(json_reader_consume_value(&reader));
+    });
+
+    free(compact);
+    free(indented);
+}
+
+
+/* The recursive walk json_reader_consume_value used to do. */
+static JsonError
+consume_recursive(JSON* json) {
+    JsonValueType type;
+    JsonError err = json_reader_peek_value(json, &type);
+    if (err != JsonError_ok) { return err; }
+    switch (type) {
+        case JsonValueType_array: {
+            JSON array;
+            err = json_reader_open_array(json, &array);
+            if (err != JsonError_ok) { return err; }
+            for (;;) {
+                err = json_reader_read_array(&array, &type);
+                if (err == JsonError_not_found) { return JsonError_ok; }
+                if (err != JsonError_ok) { return err; }
+                err = consume_recursive(&array);
+                if (err != JsonError_ok) { return err; }
+            }
+        }
+        case JsonValueType_object: {
+            JSON object;
+            err = json_reader_open_object(json, &object);
+            if (err != JsonError_ok) { return err; }
+            for (;;) {
+                char key[64];
+                sz key_size = sizeof(key);
+                err = json_reader_read_object(&object, &key_size, key, &type);
+                if (err == JsonError_not_found) { return JsonError_ok; }
+                if (err != JsonError_ok) { return err; }
+                err = consume_recursive(&object);
+                if (err != JsonError_ok) { return err; }
+            }
+        }
+        default:
+            return json_reader_consume_value(json);
+    }
+}
+
+
+static void
+bench_skip(int count) {
+    sz cap = (sz) count * 512;
+    char* data = (char*) malloc(cap);
+    if (data == nullptr) { fatal_perror("malloc"); }
+    sz size = render_document(data, cap, count);
+
+    bench("reader consume recursive", size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(consume_recursive(&reader));
+    });
+    bench("reader consume_value", size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_consume_value(&reader));
+    });
+    bench("reader skip_value", size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_skip_value(&reader));
+    });
+
+    char pointer[32];
+    snprintf(pointer, sizeof(pointer), "/%d/name", count - 1);
+    bench("reader seek_pointer", size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_seek_pointer(&reader, pointer));
+    });
+
+    char paths[3][32];
+    snprintf(paths[0], sizeof(paths[0]), "/%d/id", count / 4);
+    snprintf(paths[1], sizeof(paths[1]), "/%d/score", count / 2);
+    snprintf(paths[2], sizeof(paths[2]), "/%d/name", count - 1);
+    cs* pointers[] = {paths[0], paths[1], paths[2]};
+    bench("reader seek_pointer x3", size, 3, [&] {
+        for (cs* p : pointers) {
+            JSON reader;
+            check_ok(json_reader_init_buffer(&reader, data, size));
+            check_ok(json_reader_seek_pointer(&reader, p));
+        }
+    });
+    char storage[1024];
+    JsonProjection projection;
+    check_ok(json_projection_init(&projection, pointers, 3, storage, sizeof(storage)));
+    bench("reader project x3", size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_project(&reader, &projection, [] (void*, int, JSON* value) {
+            return json_reader_skip_value(value);
+        }, nullptr));
+    });
+
+    JsonIndexEntry* entries = (JsonIndexEntry*) malloc(size * sizeof(JsonIndexEntry));
+    if (entries == nullptr) { fatal_perror("malloc"); }
+    sz count_entries = size;
+    bench("reader build_index", size, 3, [&] {
+        JSON reader;
+        count_entries = size;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_build_index(&reader, entries, &count_entries));
+    });
+    bench("reader build_index + skip_value", size, 3, [&] {
+        JSON reader;
+        count_entries = size;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_build_index(&reader, entries, &count_entries));
+        check_ok(json_reader_skip_value(&reader));
+    });
+
+    free(entries);
+    free(data);
+}
+
+
+static void
+bench_numbers(int count) {
+    sz cap = (sz) count * 32 + 2;
+    char* data = (char*) malloc(cap);
+    if (data == nullptr) { fatal_perror("malloc"); }
+    char* p = data;
+    *p++ = '[';
+    srand(8);
+    for (int i = 0; i < count; ++i) {
+        r64 x = (rand() - RAND_MAX / 2) / 1e3 * (rand() % 1000);
+        p += snprintf(p, 32, i == 0 ? "%.17g" : ",%.17g", x);
+    }
+    *p++ = ']';
+    sz size = p - data;
+
+    bench("reader numberd", size, 3, [&] {
+        JSON reader, array;
+        JsonValueType type;
+        r64 sum = 0;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_open_array(&reader, &array));
+        while (json_reader_read_array(&array, &type) == JsonError_ok) {
+            r64 x;
+            check_ok(json_reader_read_numberd(&array, &x));
+            sum += x;
+        }
+        if (sum == 0.5) { printf("\n"); }
+    });
+    bench("writer numberd", size, 3, [&] {
+        JSON writer, array;
+        check_ok(json_writer_init_buffer(&writer, data, cap, nullptr, nullptr));
+        check_ok(json_writer_open_array(&writer, &array));
+        srand(8);
+        for (int i = 0; i < count; ++i) {
+            r64 x = (rand() - RAND_MAX / 2) / 1e3 * (rand() % 1000);
+            check_ok(json_writer_write_array_value_separator(&array));
+            check_ok(json_writer_write_numberd(&array, x));
+        }
+        check_ok(json_writer_close_array(&array));
+    });
+
+    p = data;
+    *p++ = '[';
+    for (int i = 0; i < count; ++i) {
+        long long x = 1700000000000ll + (long long) i * 7919 + rand() % 1000;
+        p += snprintf(p, 32, i == 0 ? "%lld" : ",%lld", x);
+    }
+    *p++ = ']';
+    size = p - data;
+
+    bench("reader numberll", size, 3, [&] {
+        JSON reader, array;
+        JsonValueType type;
+        long long sum = 0;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_open_array(&reader, &array));
+        while (json_reader_read_array(&array, &type) == JsonError_ok) {
+            long long x;
+            check_ok(json_reader_read_numberll(&array, &x));
+            sum += x;
+        }
+        if (sum == 1) { printf("\n"); }
+    });
+    bench("writer numberll", size, 3, [&] {
+        JSON writer, array;
+        check_ok(json_writer_init_buffer(&writer, data, cap, nullptr, nullptr));
+        check_ok(json_writer_open_array(&writer, &array));
+        for (int i = 0; i < count; ++i) {
+            check_ok(json_writer_write_array_value_separator(&array));
+            check_ok(json_writer_write_numberll(&array, 1700000000000ll + (long long) i * 7919));
+        }
+        check_ok(json_writer_close_array(&array));
+    });
+
+    free(data);
+}
+
+
+static void
+bench_document(int count) {
+    sz cap = (sz) count * 512;
+    char* data = (char*) malloc(cap);
+    if (data == nullptr) { fatal_perror("malloc"); }
+    sz size = render_document(data, cap, count);
+    sz arena_size = size * 4 + 4096;
+    char* arena = (char*) malloc(arena_size);
+    if (arena == nullptr) { fatal_perror("malloc"); }
+    JsonDocument doc;
+    check_ok(json_document_init(&doc, arena, arena_size));
+
+    bench("document parse", size, 3, [&] {
+        JSON reader;
+        const JsonNode* root;
+        json_document_reset(&doc);
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_document_parse(&doc, &reader, &root));
+    });
+
+    JSON reader;
+    const JsonNode* root;
+    json_document_reset(&doc);
+    check_ok(json_reader_init_buffer(&reader, data, size));
+    check_ok(json_document_parse(&doc, &reader, &root));
+    bench("document write_node", size, 3, [&] {
+        JSON writer;
+        check_ok(json_writer_init_buffer(&writer, data, cap, nullptr, nullptr));
+        check_ok(json_writer_write_node(&writer, root, 0));
+    });
+
+    bench("array consume_value", size, 3, [&] {
+        JSON reader;
+        JSON array;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_open_array(&reader, &array));
+        while (json_reader_read_array(&array, nullptr) == JsonError_ok) {
+            check_ok(json_reader_consume_value(&array));
+        }
+    });
+
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    JsonParallel parallel = {};
+    parallel.record = [] (void*, int, JSON* array, const JsonRecord*) {
+        return json_reader_consume_value(array);
+    };
+    parallel.threads = threads;
+    char name[40];
+    snprintf(name, sizeof(name), "array parallel x%d", threads);
+    bench(name, size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_parallel_array(&reader, &parallel));
+    });
+
+    free(arena);
+    free(data);
+}
+
+
+static sz
+render_records(char* buf, sz buf_size, int count) {
+    sz size = render_document(buf, buf_size, count);
+    /* one array element per line, without the brackets */
+    int nesting = 0;
+    int in_string = 0;
+    sz n = 0;
+    for (sz i = 1; i + 1 < size; ++i) {
+        char c = buf[i];
+        if (in_string) {
+            if (c == '\\') { buf[n++] = c; c = buf[++i]; }
+            else if (c == '"') { in_string = 0; }
+        }
+        else if (c == '"') { in_string = 1; }
+        else if (c == '[' || c == '{') { nesting++; }
+        else if (c == ']' || c == '}') { nesting--; }
+        else if (c == ',' && nesting == 0) { c = '\n'; }
+        buf[n++] = c;
+    }
+    buf[n++] = '\n';
+    return n;
+}
+
+
+static void
+bench_records(int count) {
+    sz cap = (sz) count * 512;
+    char* data = (char*) malloc(cap);
+    if (data == nullptr) { fatal_perror("malloc"); }
+    sz size = render_records(data, cap, count);
+
+    bench("records consume_value", size, 3, [&] {
+        JSON reader;
+        JsonRecord record;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        while (json_reader_next_record(&reader, &record) == JsonError_ok) {
+            check_ok(json_reader_consume_value(&reader));
+        }
+    });
+    bench("records skip_record", size, 3, [&] {
+        JSON reader;
+        JsonRecord record;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        while (json_reader_next_record(&reader, &record) == JsonError_ok) {
+            check_ok(json_reader_skip_record(&reader));
+        }
+    });
+
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    JsonParallel parallel = {};
+    parallel.record = [] (void*, int, JSON* reader, const JsonRecord*) {
+        return json_reader_consume_value(reader);
+    };
+    parallel.threads = threads;
+    char name[40];
+    snprintf(name, sizeof(name), "records parallel x%d", threads);
+    bench(name, size, 3, [&] {
+        JSON reader;
+        check_ok(json_reader_init_buffer(&reader, data, size));
+        check_ok(json_reader_parallel_records(&reader, &parallel));
+    });
+
+    free(data);
+}
+
+
+int main(int argc, const char* argv[]) {
+    int count = 200000;
+    if (argc > 1) {
+        count = atoi(argv[1]);
+    }
+
+    bench_stdio_locking(count);
+    bench_writer_buffer(count);
+    bench_whitespace(count);
+    bench_numbers(count);
+    bench_skip(count);
+    bench_document(count);
+    bench_records(count);
+
+    return 0;
+}
@@ -1,7 +1,11 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #define PAIV_JSON_IMPLEMENTATION
 #include "paiv_json.h"
@@ -53,7 +57,7 @@ write_file(cs* filename, cs* data) {
 
 template<class Worker>
 static void
-test_reader(cs* filename, cs* data, Worker worker) {
+test_file_reader(cs* filename, cs* data, Worker worker) {
     // write_file(filename, data);
     // FILE* fp = fopen(filename, "r");
     FILE* fp = fmemopen((char*)data, strlen(data), "r");
@@ -69,6 +73,102 @@ test_reader(cs* filename, cs* data, Worker worker) {
 }
 
 
+template<class Worker>
+static void
+test_unlocked_reader(cs* filename, cs* data, Worker worker) {
+    FILE* fp = fmemopen((char*)data, strlen(data), "r");
+    if (fp == nullptr) { fatal_perror(filename); }
+
+    JSON json;
+    JsonError err = json_reader_init_unlocked(&json, fp);
+    assert(err == JsonError_ok);
+
+    worker(&json);
+
+    err = json_reader_close(&json);
+    assert(err == JsonError_ok);
+    fclose(fp);
+}
+
+
+template<class Worker>
+static void
+test_buffer_reader(cs* filename, cs* data, Worker worker) {
+    JSON json;
+    JsonError err = json_reader_init_buffer(&json, data, strlen(data));
+    assert(err == JsonError_ok);
+
+    worker(&json);
+}
+
+
+typedef struct {
+    cs* data;
+    sz size;
+    sz step;
+    char window[16];
+} ChunkedSource;
+
+
+static JsonError
+chunked_source_read(void* user_data, cs** data, sz* size) {
+    ChunkedSource* source = (ChunkedSource*) user_data;
+    if (source->size == 0) { return JsonError_eof; }
+    sz n = source->size < source->step ? source->size : source->step;
+    memcpy(source->window, source->data, n);
+    source->data += n;
+    source->size -= n;
+    *data = source->window;
+    *size = n;
+    return JsonError_ok;
+}
+
+
+template<class Worker>
+static void
+test_source_reader(cs* filename, cs* data, Worker worker) {
+    ChunkedSource source = { data, strlen(data), 3 };
+    JSON json;
+    JsonError err = json_reader_init_source(&json, chunked_source_read, &source);
+    assert(err == JsonError_ok);
+
+    worker(&json);
+}
+
+
+template<class Worker>
+static void
+test_pipe_reader(cs* filename, cs* data, Worker worker) {
+    char path[100];
+    snprintf(path, sizeof(path), "bin/%s", filename);
+    write_file(path, data);
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) { fatal_perror(path); }
+
+    char storage[256];
+    JSON json;
+    JsonError err = json_reader_init_pipe(&json, fp, 5, storage, sizeof(storage));
+    assert(err == JsonError_ok);
+
+    worker(&json);
+
+    err = json_reader_close(&json);
+    assert(err == JsonError_ok);
+    fclose(fp);
+}
+
+
+template<class Worker>
+static void
+test_reader(cs* filename, cs* data, Worker worker) {
+    test_file_reader(filename, data, worker);
+    test_unlocked_reader(filename, data, worker);
+    test_buffer_reader(filename, data, worker);
+    test_source_reader(filename, data, worker);
+    test_pipe_reader(filename, data, worker);
+}
+
+
 static void
 test1_hello() {
     cs* data = R"(
@@ -269,11 +369,14 @@ test6_chunked_read() {
 static void
 test7_numbers_i32() {
     cs* data = R"(
-    [0, 1, -1, -2147483648, 2147483647, 4294967295]
+    [0, 1, -1, -2147483648, 2147483647, 4294967295, 2147483648, -2147483649]
     )";
     test_reader("test7.json", data, [] (JSON* json) {
-        i32 expect_s[] = {0, 1, -1, -2147483648, 2147483647, -1};
+        i32 expect_s[] = {0, 1, -1, -2147483648, 2147483647, 0, 0, 0};
+        JsonError expect_err[] = {JsonError_ok, JsonError_ok, JsonError_ok, JsonError_ok, JsonError_ok,
+            JsonError_range, JsonError_range, JsonError_range};
         i32* pexpect = expect_s;
+        JsonError* perr = expect_err;
         JSON array;
         JsonValueType type;
         JsonError err = json_reader_open_array(json, &array);
@@ -284,8 +387,9 @@ test7_numbers_i32() {
             assert(err == JsonError_ok);
             int value;
             err = json_reader_read_numberi(&array, &value);
-            assert(err == JsonError_ok);
-            assert(value == *pexpect++);
+            assert(err == *perr++);
+            assert(err != JsonError_ok || value == *pexpect);
+            pexpect++;
         }
     });
 }
@@ -312,12 +416,42 @@ test8_numbers_i64() {
             err = json_reader_read_array(&array, &type);
             if (err == JsonError_not_found) { break; }
             assert(err == JsonError_ok);
-            i64 value;
+            long long value;
             err = json_reader_read_numberll(&array, &value);
             assert(err == JsonError_ok);
             assert(value == *pexpect++);
         }
     });
+
+    cs* out_of_range = "[9223372036854775808, -9223372036854775809]";
+    test_reader("test8.json", out_of_range, [] (JSON* json) {
+        JSON array;
+        assert(json_reader_open_array(json, &array) == JsonError_ok);
+        for (int i = 0; i < 2; ++i) {
+            long long value;
+            assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+            assert(json_reader_read_numberll(&array, &value) == JsonError_range);
+        }
+    });
+
+    cs* limits = "[-9223372036854775808, 9223372036854775807, 2147483648, -2147483649]";
+    test_reader("test8.json", limits, [] (JSON* json) {
+        JSON array;
+        long value;
+        assert(json_reader_open_array(json, &array) == JsonError_ok);
+        assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+        JsonError err = json_reader_read_numberl(&array, &value);
+        assert(sizeof(long) == 8 ? err == JsonError_ok && value == LONG_MIN : err == JsonError_range);
+        assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+        err = json_reader_read_numberl(&array, &value);
+        assert(sizeof(long) == 8 ? err == JsonError_ok && value == LONG_MAX : err == JsonError_range);
+        assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+        err = json_reader_read_numberl(&array, &value);
+        assert(sizeof(long) == 8 ? err == JsonError_ok && value == 2147483648l : err == JsonError_range);
+        assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+        err = json_reader_read_numberl(&array, &value);
+        assert(sizeof(long) == 8 ? err == JsonError_ok && value == -2147483649l : err == JsonError_range);
+    });
 }
 
 
@@ -376,6 +510,1830 @@ test10_consume_values() {
 }
 
 
+static void
+test11_mmap() {
+    cs* filename = "bin/test11.json";
+    write_file(filename, R"(
+    {"answer": 42, "items": [1, 2, 3]}
+    )");
+    JSON json, object;
+    JsonValueType type;
+    JsonError err = json_reader_init_mmap(&json, filename);
+    assert(err == JsonError_ok);
+    err = json_reader_open_object(&json, &object);
+    assert(err == JsonError_ok);
+    char key[100];
+    sz nkey = sizeof(key);
+    err = json_reader_read_object(&object, &nkey, key, &type);
+    assert(err == JsonError_ok);
+    assert(strcmp(key, "answer") == 0);
+    i32 x;
+    err = json_reader_read_numberi(&object, &x);
+    assert(err == JsonError_ok);
+    assert(x == 42);
+    nkey = sizeof(key);
+    err = json_reader_read_object(&object, &nkey, key, &type);
+    assert(err == JsonError_ok);
+    assert(type == JsonValueType_array);
+    err = json_reader_consume_value(&object);
+    assert(err == JsonError_ok);
+    err = json_reader_read_object(&object, &nkey, key, &type);
+    assert(err == JsonError_not_found);
+    err = json_reader_close(&json);
+    assert(err == JsonError_ok);
+    remove(filename);
+
+    err = json_reader_init_mmap(&json, "bin/test11-missing.json");
+    assert(err == JsonError_read);
+    err = json_reader_init_mmap(&json, "/dev/null");
+    assert(err == JsonError_read);
+    cs* fifo = "bin/test11.fifo";
+    remove(fifo);
+    assert(mkfifo(fifo, 0600) == 0);
+    err = json_reader_init_mmap(&json, fifo);
+    assert(err == JsonError_read);
+    remove(fifo);
+}
+
+
+typedef struct {
+    char data[1024];
+    sz size;
+    int flush_count;
+} OutputSink;
+
+
+static JsonError
+output_sink_flush(void* user_data, cs* data, sz size) {
+    OutputSink* sink = (OutputSink*) user_data;
+    if (sink->size + size > sizeof(sink->data)) { return JsonError_write; }
+    memcpy(&sink->data[sink->size], data, size);
+    sink->size += size;
+    sink->flush_count++;
+    return JsonError_ok;
+}
+
+
+static void
+test12_buffer_writer() {
+    cs* expect = R"({"answer":42,"list":[-1.5,true,null],"text":"a\"b"})";
+    char buf[8];
+    OutputSink sink = {};
+    JSON json, object, array;
+    JsonError err = json_writer_init_buffer(&json, buf, sizeof(buf), output_sink_flush, &sink);
+    assert(err == JsonError_ok);
+    assert(json_writer_open_object(&json, &object) == JsonError_ok);
+    assert(json_writer_write_object_value_separator(&object) == JsonError_ok);
+    assert(json_writer_write_string(&object, "answer") == JsonError_ok);
+    assert(json_writer_write_object_key_separator(&object) == JsonError_ok);
+    assert(json_writer_write_numberi(&object, 42) == JsonError_ok);
+    assert(json_writer_write_object_value_separator(&object) == JsonError_ok);
+    assert(json_writer_write_string(&object, "list") == JsonError_ok);
+    assert(json_writer_write_object_key_separator(&object) == JsonError_ok);
+    assert(json_writer_open_array(&object, &array) == JsonError_ok);
+    assert(json_writer_write_array_value_separator(&array) == JsonError_ok);
+    assert(json_writer_write_numberd(&array, -1.5) == JsonError_ok);
+    assert(json_writer_write_array_value_separator(&array) == JsonError_ok);
+    assert(json_writer_write_bool(&array, 1) == JsonError_ok);
+    assert(json_writer_write_array_value_separator(&array) == JsonError_ok);
+    assert(json_writer_write_null(&array) == JsonError_ok);
+    assert(json_writer_close_array(&array) == JsonError_ok);
+    assert(json_writer_write_object_value_separator(&object) == JsonError_ok);
+    assert(json_writer_write_string(&object, "text") == JsonError_ok);
+    assert(json_writer_write_object_key_separator(&object) == JsonError_ok);
+    assert(json_writer_write_string(&object, "a\"b") == JsonError_ok);
+    assert(json_writer_close_object(&object) == JsonError_ok);
+    err = json_writer_close(&json);
+    assert(err == JsonError_ok);
+    assert(sink.size == strlen(expect));
+    assert(memcmp(sink.data, expect, sink.size) == 0);
+    assert(sink.flush_count > 1);
+
+    char small[6];
+    err = json_writer_init_buffer(&json, small, sizeof(small), nullptr, nullptr);
+    assert(err == JsonError_ok);
+    assert(json_writer_write_null(&json) == JsonError_ok);
+    assert(json_writer_buffer_size(&json) == 4);
+    assert(json_writer_write_bool(&json, 0) == JsonError_write);
+
+    err = json_writer_init_buffer(&json, nullptr, 0, nullptr, nullptr);
+    assert(err == JsonError_ok);
+    assert(json_writer_write_null(&json) == JsonError_write);
+    assert(json_writer_close(&json) == JsonError_ok);
+}
+
+
+static void
+test13_long_strings() {
+    cs* data = R"(
+    ["The quick brown fox jumps over the lazy dog, then naps under a tree by the river",
+     "tab\tseparated\tvalues with a \"quoted\" part and a \\ backslash, \u0041 and more text",
+     "é, ü and other UTF-8 bytes: ÀÉÎÕÜ àéîõü ÀÉÎÕÜ àéîõü ÀÉÎÕÜ àéîõü ÀÉÎÕÜ",
+     "control in the middle of a long run of plain characters: abcdefghijklmnop
+"]
+    )";
+    cs* expect_s[] = {
+        "The quick brown fox jumps over the lazy dog, then naps under a tree by the river",
+        "tab\tseparated\tvalues with a \"quoted\" part and a \\ backslash, A and more text",
+        "é, ü and other UTF-8 bytes: ÀÉÎÕÜ àéîõü ÀÉÎÕÜ àéîõü ÀÉÎÕÜ àéîõü ÀÉÎÕÜ",
+    };
+    for (sz chunk = 2; chunk < 40; ++chunk) {
+        test_reader("test13.json", data, [chunk, expect_s] (JSON* json) {
+            JSON array;
+            JsonValueType type;
+            JsonError err = json_reader_open_array(json, &array);
+            assert(err == JsonError_ok);
+            for (sz i = 0; i < 3; ++i) {
+                err = json_reader_read_array(&array, &type);
+                assert(err == JsonError_ok);
+                char buf[200];
+                sz offset = 0;
+                sz bufsize = chunk;
+                err = json_reader_read_string(&array, &bufsize, buf);
+                while (err == JsonError_bufsize) {
+                    offset += bufsize;
+                    assert(offset + chunk <= sizeof(buf));
+                    bufsize = chunk;
+                    err = json_reader_resume_string(&array, &bufsize, &buf[offset]);
+                }
+                assert(err == JsonError_ok);
+                assert(strcmp(buf, expect_s[i]) == 0);
+            }
+            err = json_reader_read_array(&array, &type);
+            assert(err == JsonError_ok);
+            err = json_reader_consume_value(&array);
+            assert(err == JsonError_invalid);
+        });
+    }
+    test_reader("test13.json", data, [] (JSON* json) {
+        JSON array;
+        JsonValueType type;
+        JsonError err = json_reader_open_array(json, &array);
+        assert(err == JsonError_ok);
+        for (sz i = 0; i < 3; ++i) {
+            err = json_reader_read_array(&array, &type);
+            assert(err == JsonError_ok);
+            err = json_reader_consume_value(&array);
+            assert(err == JsonError_ok);
+        }
+        err = json_reader_read_array(&array, &type);
+        assert(err == JsonError_ok);
+        char buf[200];
+        sz bufsize = sizeof(buf);
+        err = json_reader_read_string(&array, &bufsize, buf);
+        assert(err == JsonError_invalid);
+    });
+}
+
+
+static void
+test14_number_conversion() {
+    cs* samples[] = {
+        "0", "-0", "1", "0.1", "0.3", "1e23", "8.98846567431158e307",
+        "2.2250738585072011e-308", "2.2250738585072012e-308", "4.9406564584124654e-324",
+        "2.4703282292062327e-324", "2.4703282292062328e-324", "1.7976931348623157e308",
+        "1.7976931348623158e308", "1.7976931348623159e308", "1e309", "1e-400", "123456789012345678901234567890",
+        "9007199254740993", "9007199254740992.999999999999999999999999", "0.000000000000000000000000000001",
+        "7.038531e-26", "3.4028235e38", "3.4028236e38", "1.17549435e-38", "1.4e-45", "7e-46",
+        "2.00000000000000011102230246251565404236316680908203125",
+        "2.00000000000000011102230246251565404236316680908203124",
+        "2.00000000000000011102230246251565404236316680908203126",
+        "0.500000000000000166533453693773481063544750213623046875",
+        "3.518437208883201171875e13", "62.5364939768271845828", "8.10109172351e-10",
+        "1.00000005960464477550", "1.00000005960464477539062499999", "1.0000000596046447753906250000000000000000000000000000000000000000001",
+        "1e-10000", "1e10000", "0e10000", "-1.5e-5", "1E+2", "1e-0",
+    };
+    char data[4096];
+    char* p = data;
+    p += sprintf(p, "[");
+    for (sz i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+        p += sprintf(p, "%s%s", i == 0 ? "" : ",", samples[i]);
+    }
+    sprintf(p, "]");
+    test_reader("test14.json", data, [samples] (JSON* json) {
+        JSON array;
+        JsonValueType type;
+        JsonError err = json_reader_open_array(json, &array);
+        assert(err == JsonError_ok);
+        for (sz i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+            err = json_reader_read_array(&array, &type);
+            assert(err == JsonError_ok);
+            r64 value;
+            err = json_reader_read_numberd(&array, &value);
+            assert(err == JsonError_ok);
+            r64 expect = strtod(samples[i], nullptr);
+            assert(memcmp(&value, &expect, sizeof(value)) == 0);
+        }
+    });
+    test_reader("test14.json", data, [samples] (JSON* json) {
+        JSON array;
+        JsonValueType type;
+        JsonError err = json_reader_open_array(json, &array);
+        assert(err == JsonError_ok);
+        for (sz i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+            err = json_reader_read_array(&array, &type);
+            assert(err == JsonError_ok);
+            r32 value;
+            err = json_reader_read_numberf(&array, &value);
+            assert(err == JsonError_ok);
+            r32 expect = strtof(samples[i], nullptr);
+            assert(memcmp(&value, &expect, sizeof(value)) == 0);
+        }
+    });
+
+    srand(14);
+    for (int round = 0; round < 20000; ++round) {
+        char buf[64];
+        u64 bits = 0;
+        for (int i = 0; i < 4; ++i) { bits = (bits << 16) ^ (rand() & 0xFFFF); }
+        r64 x;
+        memcpy(&x, &bits, sizeof(x));
+        if (x != x || x - x != 0) { continue; }
+        switch (round % 3) {
+            case 0: snprintf(buf, sizeof(buf), "%.17g", x); break;
+            case 1: snprintf(buf, sizeof(buf), "%.*e", rand() % 25, x); break;
+            default: snprintf(buf, sizeof(buf), "%u.%ue%d", rand(), rand(), rand() % 700 - 350); break;
+        }
+        JSON json;
+        assert(json_reader_init_buffer(&json, buf, strlen(buf)) == JsonError_ok);
+        r64 value;
+        assert(json_reader_read_numberd(&json, &value) == JsonError_ok);
+        r64 expect = strtod(buf, nullptr);
+        assert(memcmp(&value, &expect, sizeof(value)) == 0);
+        assert(json_reader_init_buffer(&json, buf, strlen(buf)) == JsonError_ok);
+        r32 valuef;
+        assert(json_reader_read_numberf(&json, &valuef) == JsonError_ok);
+        r32 expectf = strtof(buf, nullptr);
+        assert(memcmp(&valuef, &expectf, sizeof(valuef)) == 0);
+    }
+
+    cs* integers = R"(
+    [1e3, 1.9, -1.9, 12.5e1, 0.0000001e7, 9223372036854775807.4,
+        9223372036854775808, -9223372036854775809, 1e19, 12345678901234567890123]
+    )";
+    test_reader("test14.json", integers, [] (JSON* json) {
+        i64 expect_s[] = {1000, 1, -1, 125, 1, INT64_MAX};
+        JSON array;
+        JsonValueType type;
+        JsonError err = json_reader_open_array(json, &array);
+        assert(err == JsonError_ok);
+        for (sz i = 0; i < 10; ++i) {
+            err = json_reader_read_array(&array, &type);
+            assert(err == JsonError_ok);
+            long long value;
+            err = json_reader_read_numberll(&array, &value);
+            if (i < 6) {
+                assert(err == JsonError_ok);
+                assert(value == expect_s[i]);
+            }
+            else {
+                assert(err == JsonError_range);
+            }
+        }
+    });
+}
+
+
+static sz
+format_numberd(char* buf, sz buf_size, r64 value) {
+    JSON json;
+    assert(json_writer_init_buffer(&json, buf, buf_size, nullptr, nullptr) == JsonError_ok);
+    assert(json_writer_write_numberd(&json, value) == JsonError_ok);
+    sz n = json_writer_buffer_size(&json);
+    buf[n] = '\0';
+    return n;
+}
+
+
+static sz
+format_numberf(char* buf, sz buf_size, r32 value) {
+    JSON json;
+    assert(json_writer_init_buffer(&json, buf, buf_size, nullptr, nullptr) == JsonError_ok);
+    assert(json_writer_write_numberf(&json, value) == JsonError_ok);
+    sz n = json_writer_buffer_size(&json);
+    buf[n] = '\0';
+    return n;
+}
+
+
+static sz
+significant_digits(cs* s) {
+    sz n = 0;
+    sz zeros = 0;
+    for (; *s != '\0' && *s != 'e'; ++s) {
+        if (*s < '0' || *s > '9') { continue; }
+        if (*s == '0') {
+            if (n != 0) { zeros++; }
+            continue;
+        }
+        n += zeros + 1;
+        zeros = 0;
+    }
+    return n;
+}
+
+
+static void
+test15_number_formatting() {
+    struct { r64 value; cs* expect; } doubles[] = {
+        {0, "0"}, {-0.0, "-0"}, {1, "1"}, {-1.5, "-1.5"}, {0.1, "0.1"}, {0.3, "0.3"},
+        {100, "100"}, {1e16, "10000000000000000"}, {1e17, "1e+17"}, {123456.789, "123456.789"},
+        {0.0001, "0.0001"}, {0.00001, "1e-05"}, {1e23, "1e+23"}, {5e-324, "5e-324"},
+        {1.7976931348623157e308, "1.7976931348623157e+308"}, {2.2250738585072014e-308, "2.2250738585072014e-308"},
+        {9007199254740993.0, "9007199254740992"}, {0.1 + 0.2, "0.30000000000000004"},
+        {1.0 / 0.0, "inf"}, {-1.0 / 0.0, "-inf"},
+    };
+    char buf[64];
+    for (auto& t : doubles) {
+        format_numberd(buf, sizeof(buf), t.value);
+        assert(strcmp(buf, t.expect) == 0);
+    }
+    struct { r32 value; cs* expect; } floats[] = {
+        {0, "0"}, {1.5f, "1.5"}, {0.1f, "0.1"}, {16777216.0f, "16777216"}, {3.4028235e38f, "3.4028235e+38"},
+        {1e-45f, "1e-45"}, {1.17549435e-38f, "1.1754944e-38"}, {123456789.0f, "123456790"},
+    };
+    for (auto& t : floats) {
+        format_numberf(buf, sizeof(buf), t.value);
+        assert(strcmp(buf, t.expect) == 0);
+    }
+
+    char small[8];
+    OutputSink sink = {};
+    JSON json;
+    assert(json_writer_init_buffer(&json, small, sizeof(small), output_sink_flush, &sink) == JsonError_ok);
+    assert(json_writer_write_numberd(&json, -2.2250738585072014e-308) == JsonError_ok);
+    assert(json_writer_close(&json) == JsonError_ok);
+    assert(sink.size == 24 && memcmp(sink.data, "-2.2250738585072014e-308", 24) == 0);
+
+    srand(15);
+    for (int round = 0; round < 20000; ++round) {
+        u64 bits = 0;
+        for (int i = 0; i < 4; ++i) { bits = (bits << 16) ^ (rand() & 0xFFFF); }
+        r64 x;
+        memcpy(&x, &bits, sizeof(x));
+        if (x != x || x - x != 0) { continue; }
+        format_numberd(buf, sizeof(buf), x);
+        r64 y = strtod(buf, nullptr);
+        assert(memcmp(&x, &y, sizeof(x)) == 0);
+        char expect[64];
+        for (int precision = 1; precision <= 17; ++precision) {
+            snprintf(expect, sizeof(expect), "%.*e", precision - 1, x);
+            if (strtod(expect, nullptr) == x) { break; }
+        }
+        assert(significant_digits(buf) == significant_digits(expect));
+
+        r32 xf;
+        memcpy(&xf, &bits, sizeof(xf));
+        if (xf != xf || xf - xf != 0) { continue; }
+        format_numberf(buf, sizeof(buf), xf);
+        r32 yf = strtof(buf, nullptr);
+        assert(memcmp(&xf, &yf, sizeof(xf)) == 0);
+        for (int precision = 1; precision <= 9; ++precision) {
+            snprintf(expect, sizeof(expect), "%.*e", precision - 1, xf);
+            if (strtof(expect, nullptr) == xf) { break; }
+        }
+        assert(significant_digits(buf) == significant_digits(expect));
+    }
+}
+
+
+static void
+test16_integer_formatting() {
+    long long values[64 + 4 + 2000];
+    sz count = 0;
+    long long power = 1;
+    for (int i = 0; i < 19; ++i) {
+        values[count++] = power;
+        values[count++] = power - 1;
+        values[count++] = -power;
+        values[count++] = 1 - power;
+        if (i < 18) { power *= 10; }
+    }
+    values[count++] = INT64_MIN;
+    values[count++] = INT64_MAX;
+    values[count++] = INT32_MIN;
+    values[count++] = INT32_MAX;
+    srand(16);
+    while (count < sizeof(values) / sizeof(values[0])) {
+        u64 bits = 0;
+        for (int i = 0; i < 4; ++i) { bits = (bits << 16) ^ (rand() & 0xFFFF); }
+        values[count++] = (long long) (bits >> (rand() % 64));
+    }
+
+    char buf[64];
+    char expect[64];
+    for (sz i = 0; i < count; ++i) {
+        JSON json;
+        assert(json_writer_init_buffer(&json, buf, sizeof(buf), nullptr, nullptr) == JsonError_ok);
+        assert(json_writer_write_numberll(&json, values[i]) == JsonError_ok);
+        buf[json_writer_buffer_size(&json)] = '\0';
+        snprintf(expect, sizeof(expect), "%lld", values[i]);
+        assert(strcmp(buf, expect) == 0);
+
+        assert(json_writer_init_buffer(&json, buf, sizeof(buf), nullptr, nullptr) == JsonError_ok);
+        assert(json_writer_write_numberi(&json, (int) values[i]) == JsonError_ok);
+        buf[json_writer_buffer_size(&json)] = '\0';
+        snprintf(expect, sizeof(expect), "%d", (int) values[i]);
+        assert(strcmp(buf, expect) == 0);
+    }
+
+    char small[8];
+    OutputSink sink = {};
+    JSON json, array;
+    assert(json_writer_init_buffer(&json, small, sizeof(small), output_sink_flush, &sink) == JsonError_ok);
+    assert(json_writer_open_array(&json, &array) == JsonError_ok);
+    assert(json_writer_write_array_value_separator(&array) == JsonError_ok);
+    assert(json_writer_write_numberl(&array, -1234567890123456789l) == JsonError_ok);
+    assert(json_writer_write_array_value_separator(&array) == JsonError_ok);
+    assert(json_writer_write_numberi(&array, 0) == JsonError_ok);
+    assert(json_writer_close_array(&array) == JsonError_ok);
+    assert(json_writer_close(&json) == JsonError_ok);
+    assert(sink.size == 24 && memcmp(sink.data, "[-1234567890123456789,0]", 24) == 0);
+}
+
+
+static void
+test17_string_writer() {
+    struct { cs* value; sz size; cs* expect; } samples[] = {
+        {"", 0, R"("")"},
+        {"plain", 5, R"("plain")"},
+        {"a\"b\\c/d", 7, R"("a\"b\\c/d")"},
+        {"\b\t\n\f\r", 5, R"("\b\t\n\f\r")"},
+        {"\x01\x1f\x7f", 3, "\"\\u0001\\u001f\x7f\""},
+        {"nul\0inside", 10, R"("nul\u0000inside")"},
+        {"é ü \xe2\x82\xac", 9, "\"é ü \xe2\x82\xac\""},
+    };
+    char buf[256];
+    for (auto& t : samples) {
+        JSON json;
+        assert(json_writer_init_buffer(&json, buf, sizeof(buf), nullptr, nullptr) == JsonError_ok);
+        assert(json_writer_write_stringn(&json, t.value, t.size) == JsonError_ok);
+        sz n = json_writer_buffer_size(&json);
+        assert(n == strlen(t.expect) && memcmp(buf, t.expect, n) == 0);
+    }
+
+    srand(17);
+    for (int round = 0; round < 500; ++round) {
+        char value[120];
+        sz size = rand() % (sizeof(value) - 1);
+        for (sz i = 0; i < size; ++i) {
+            int r = rand() % 16;
+            value[i] = r == 0 ? 1 + rand() % 31 : r == 1 ? '"' : r == 2 ? '\\' : 'a' + rand() % 26;
+        }
+        value[size] = '\0';
+
+        char small[8];
+        OutputSink sink = {};
+        JSON json;
+        assert(json_writer_init_buffer(&json, small, sizeof(small), output_sink_flush, &sink) == JsonError_ok);
+        assert(json_writer_write_string(&json, value) == JsonError_ok);
+        assert(json_writer_close(&json) == JsonError_ok);
+
+        JSON reader;
+        assert(json_reader_init_buffer(&reader, sink.data, sink.size) == JsonError_ok);
+        sz nbuf = sizeof(buf);
+        assert(json_reader_read_string(&reader, &nbuf, buf) == JsonError_ok);
+        assert(strcmp(buf, value) == 0);
+    }
+}
+
+
+static void
+test18_string_views() {
+    cs* data = R"(
+    {"name": "plain value", "esc\"aped": "tab\there A", "": ""}
+    )";
+    cs* expect_s[] = {"name", "plain value", "esc\"aped", "tab\there A", "", ""};
+    test_reader("test18.json", data, [expect_s] (JSON* json) {
+        JSON object;
+        JsonValueType type;
+        JsonError err = json_reader_open_object(json, &object);
+        assert(err == JsonError_ok);
+        char scratch[32];
+        char key_scratch[32];
+        for (sz i = 0; ; i += 2) {
+            JsonStringView key, value;
+            err = json_reader_read_object_view(&object, &key, sizeof(key_scratch), key_scratch, &type);
+            if (err == JsonError_not_found) { break; }
+            assert(err == JsonError_ok);
+            assert(type == JsonValueType_string);
+            assert(key.size == strlen(expect_s[i]) && memcmp(key.data, expect_s[i], key.size) == 0);
+            assert(key.borrowed || key.data == key_scratch);
+            err = json_reader_read_string_view(&object, &value, sizeof(scratch), scratch);
+            assert(err == JsonError_ok);
+            assert(value.size == strlen(expect_s[i + 1]) && memcmp(value.data, expect_s[i + 1], value.size) == 0);
+            assert(value.borrowed || value.data == scratch);
+        }
+    });
+
+    /* short keys that end inside the 3-byte window of the source reader */
+    for (int pad = 0; pad < 3; ++pad) {
+        char padded[40];
+        snprintf(padded, sizeof(padded), "{%*s\"a\":1, \"bc\": 22}", pad, "");
+        test_reader("test18.json", padded, [] (JSON* json) {
+            JSON object;
+            JsonValueType type;
+            JsonStringView key;
+            char key_scratch[8];
+            int x;
+            assert(json_reader_open_object(json, &object) == JsonError_ok);
+            assert(json_reader_read_object_view(&object, &key, sizeof(key_scratch), key_scratch, &type) == JsonError_ok);
+            assert(key.size == 1 && key.data[0] == 'a');
+            assert(json_reader_read_numberi(&object, &x) == JsonError_ok && x == 1);
+            assert(json_reader_read_object_view(&object, &key, sizeof(key_scratch), key_scratch, &type) == JsonError_ok);
+            assert(key.size == 2 && memcmp(key.data, "bc", 2) == 0);
+            assert(json_reader_read_numberi(&object, &x) == JsonError_ok && x == 22);
+            assert(json_reader_read_object_view(&object, &key, sizeof(key_scratch), key_scratch, &type) == JsonError_not_found);
+        });
+    }
+
+    /* a view borrowed from a source window is copied out before the
+       next call, which refills that window */
+    cs* windows = "[\"ab\",  \"cd\"]";
+    ChunkedSource source = { windows, strlen(windows), 6 };
+    JSON chunked, items;
+    JsonStringView first, second;
+    char first_scratch[4], second_scratch[4], copy[4];
+    assert(json_reader_init_source(&chunked, chunked_source_read, &source) == JsonError_ok);
+    assert(json_reader_open_array(&chunked, &items) == JsonError_ok);
+    assert(json_reader_read_array(&items, nullptr) == JsonError_ok);
+    assert(json_reader_read_string_view(&items, &first, sizeof(first_scratch), first_scratch) == JsonError_ok);
+    assert(first.borrowed && first.data == source.window + 2 && first.size == 2);
+    memcpy(copy, first.data, first.size);
+    assert(json_reader_read_array(&items, nullptr) == JsonError_ok);
+    assert(json_reader_read_string_view(&items, &second, sizeof(second_scratch), second_scratch) == JsonError_ok);
+    assert(second.borrowed && second.size == 2 && memcmp(second.data, "cd", 2) == 0);
+    assert(memcmp(copy, "ab", 2) == 0 && memcmp(first.data, "ab", 2) != 0);
+
+    cs* text = R"(["borrowed string", "needs \"decoding\" here", null, 42])";
+    JSON json, array;
+    JsonValueType type;
+    JsonStringView view;
+    char scratch[8];
+    assert(json_reader_init_buffer(&json, text, strlen(text)) == JsonError_ok);
+    assert(json_reader_open_array(&json, &array) == JsonError_ok);
+    assert(json_reader_read_array(&array, &type) == JsonError_ok);
+    assert(json_reader_read_string_view(&array, &view, sizeof(scratch), scratch) == JsonError_ok);
+    assert(view.borrowed && view.data == text + 2 && view.size == 15);
+
+    assert(json_reader_read_array(&array, &type) == JsonError_ok);
+    assert(json_reader_read_string_view(&array, &view, sizeof(scratch), scratch) == JsonError_bufsize);
+    assert(!view.borrowed && view.size == 7 && memcmp(scratch, "needs \"", 7) == 0);
+    char rest[32];
+    sz nrest = sizeof(rest);
+    assert(json_reader_resume_string(&array, &nrest, rest) == JsonError_ok);
+    assert(strcmp(rest, "decoding\" here") == 0);
+
+    assert(json_reader_read_array(&array, &type) == JsonError_ok);
+    assert(json_reader_read_string_view(&array, &view, sizeof(scratch), scratch) == JsonError_null);
+    assert(json_reader_read_array(&array, &type) == JsonError_ok);
+    assert(json_reader_read_string_view(&array, &view, sizeof(scratch), scratch) == JsonError_type_mismatch);
+}
+
+
+static void
+test19_key_table() {
+    static cs* keys[] = {
+        "", "a key that is longer than the sixty-four byte chunk used for stream sources",
+        "i", "id", "ids", "name",
+    };
+    JsonKeyTable table;
+    assert(json_key_table_init(&table, keys, sizeof(keys) / sizeof(keys[0])) == JsonError_ok);
+    static cs* unsorted[] = {"b", "a"};
+    JsonKeyTable bad;
+    assert(json_key_table_init(&bad, unsorted, 2) == JsonError_invalid);
+    static cs* duplicate[] = {"a", "a"};
+    assert(json_key_table_init(&bad, duplicate, 2) == JsonError_invalid);
+
+    cs* data = R"(
+    {"id": 1, "name": 2, "ids": 3, "idx": 4, "": 5, "i": 6, "I": 7, "nul\u0000": 8,
+        "a key that is longer than the sixty-four byte chunk used for stream sources": 9,
+        "a key that is longer than the sixty-four byte chunk used for stream sourcesX": 10,
+        "a key that is longer than the sixty-four byte chunk but does not match any": 11,
+        "name": {"id": [1, 2]}}
+    )";
+    test_reader("test19.json", data, [&table] (JSON* json) {
+        int expect_s[] = {3, 5, 4, -1, 0, 2, -1, -1, 1, -1, -1, 5};
+        JSON object;
+        JsonValueType type;
+        JsonError err = json_reader_open_object(json, &object);
+        assert(err == JsonError_ok);
+        for (sz i = 0; ; ++i) {
+            int key;
+            err = json_reader_read_object_key(&object, &table, &key, &type);
+            if (err == JsonError_not_found) {
+                assert(i == sizeof(expect_s) / sizeof(expect_s[0]));
+                break;
+            }
+            assert(err == JsonError_ok);
+            assert(key == expect_s[i]);
+            if (type == JsonValueType_number) {
+                int x;
+                err = json_reader_read_numberi(&object, &x);
+                assert(err == JsonError_ok);
+                assert(x == (int) i + 1);
+            }
+            else {
+                err = json_reader_consume_value(&object);
+                assert(err == JsonError_ok);
+            }
+        }
+    });
+}
+
+
+static void
+test20_skip_value() {
+    cs* data = R"(
+    [{"nested": [[1, 2, [3, {"deep": [[[[[[[[]]]]]]]]}]], {"a": {"b": {"c": {}}}}],
+      "brackets in strings": "[[[{{{\"]]]}}}\\", "more": "}]"},
+     "string with \"escaped\" quotes and a ] bracket",
+     -12.5e+3, true, false, null, [], {},
+     [{"x": "0123456789abcdef0123456789abcdef"}, {"y": ["0123456789abcdef", "]]]]]]]]]]]]]]]]"]}],
+     42]
+    )";
+    auto worker = [] (JSON* json, JsonError (*skip)(JSON*)) {
+        JSON array;
+        JsonValueType type;
+        JsonError err = json_reader_open_array(json, &array);
+        assert(err == JsonError_ok);
+        for (int i = 0; i < 9; ++i) {
+            err = json_reader_read_array(&array, &type);
+            assert(err == JsonError_ok);
+            err = skip(&array);
+            assert(err == JsonError_ok);
+        }
+        err = json_reader_read_array(&array, &type);
+        assert(err == JsonError_ok);
+        assert(type == JsonValueType_number);
+        int x;
+        err = json_reader_read_numberi(&array, &x);
+        assert(err == JsonError_ok);
+        assert(x == 42);
+        err = json_reader_read_array(&array, &type);
+        assert(err == JsonError_not_found);
+    };
+    test_reader("test20.json", data, [worker] (JSON* json) { worker(json, json_reader_consume_value); });
+    test_reader("test20.json", data, [worker] (JSON* json) { worker(json, json_reader_skip_value); });
+
+    cs* invalid = R"([{"a" 1, "b": tru, 2: [1 2]}, 7])";
+    test_reader("test20.json", invalid, [] (JSON* json) {
+        JSON array;
+        JsonValueType type;
+        assert(json_reader_open_array(json, &array) == JsonError_ok);
+        assert(json_reader_read_array(&array, &type) == JsonError_ok);
+        assert(json_reader_consume_value(&array) == JsonError_invalid);
+    });
+    test_reader("test20.json", invalid, [] (JSON* json) {
+        JSON array;
+        JsonValueType type;
+        assert(json_reader_open_array(json, &array) == JsonError_ok);
+        assert(json_reader_read_array(&array, &type) == JsonError_ok);
+        assert(json_reader_skip_value(&array) == JsonError_ok);
+        assert(json_reader_read_array(&array, &type) == JsonError_ok);
+        int x;
+        assert(json_reader_read_numberi(&array, &x) == JsonError_ok);
+        assert(x == 7);
+    });
+
+    cs* truncated = R"([[1, "]", {"a": [)";
+    test_reader("test20.json", truncated, [] (JSON* json) {
+        assert(json_reader_skip_value(json) == JsonError_eof);
+    });
+}
+
+
+static char*
+nested_document(sz depth, int close) {
+    char* data = (char*) malloc(depth * 6 + 2);
+    if (data == nullptr) { fatal_perror("malloc"); }
+    char* p = data;
+    for (sz i = 0; i < depth; ++i) {
+        memcpy(p, i % 2 ? "{\"a\":" : "[", i % 2 ? 5 : 1);
+        p += i % 2 ? 5 : 1;
+    }
+    *p++ = '0';
+    for (sz i = depth; close && i > 0; --i) {
+        *p++ = (i - 1) % 2 ? '}' : ']';
+    }
+    *p = '\0';
+    return data;
+}
+
+
+static void
+test21_nesting_depth() {
+    char* data = nested_document(PAIV_JSON_MAX_DEPTH, 1);
+    test_reader("test21.json", data, [] (JSON* json) {
+        assert(json_reader_consume_value(json) == JsonError_ok);
+        JsonValueType type;
+        assert(json_reader_peek_value(json, &type) == JsonError_eof);
+    });
+    free(data);
+
+    data = nested_document(PAIV_JSON_MAX_DEPTH + 1, 1);
+    test_reader("test21.json", data, [] (JSON* json) {
+        assert(json_reader_consume_value(json) == JsonError_depth);
+    });
+    free(data);
+
+    data = nested_document(100000, 1);
+    JSON json;
+    assert(json_reader_init_buffer(&json, data, strlen(data)) == JsonError_ok);
+    assert(json_reader_consume_value(&json) == JsonError_depth);
+    assert(json_reader_init_buffer(&json, data, strlen(data)) == JsonError_ok);
+    assert(json_reader_skip_value(&json) == JsonError_ok);
+    free(data);
+
+    data = nested_document(100000, 0);
+    assert(json_reader_init_buffer(&json, data, strlen(data)) == JsonError_ok);
+    assert(json_reader_consume_value(&json) == JsonError_depth);
+    free(data);
+
+    data = nested_document(4, 1);
+    test_reader("test21.json", data, [] (JSON* json) {
+        assert(json_reader_set_max_depth(json, 0) == JsonError_range);
+        assert(json_reader_set_max_depth(json, PAIV_JSON_MAX_DEPTH + 1) == JsonError_range);
+        assert(json_reader_set_max_depth(json, 3) == JsonError_ok);
+        assert(json_reader_consume_value(json) == JsonError_depth);
+    });
+    test_reader("test21.json", data, [] (JSON* json) {
+        assert(json_reader_set_max_depth(json, 4) == JsonError_ok);
+        assert(json_reader_consume_value(json) == JsonError_ok);
+    });
+    test_reader("test21.json", data, [] (JSON* json) {
+        char arena[2048];
+        JsonDocument doc;
+        const JsonNode* root;
+        assert(json_document_init(&doc, arena, sizeof(arena)) == JsonError_ok);
+        assert(json_reader_set_max_depth(json, 3) == JsonError_ok);
+        assert(json_document_parse(&doc, json, &root) == JsonError_depth);
+    });
+    free(data);
+
+    cs* mixed = R"([{"a": [1, {"b": {}}, []], "c": {"d": [[], [{}]]}}, [1, [2, [3]]], {}] 5)";
+    test_reader("test21.json", mixed, [] (JSON* json) {
+        assert(json_reader_consume_value(json) == JsonError_ok);
+        int x;
+        assert(json_reader_read_numberi(json, &x) == JsonError_ok);
+        assert(x == 5);
+    });
+    cs* invalid[] = {"[1,]", "[,1]", "{\"a\":1,}", "{\"a\" 1}", "[1 2]", "[{]}", "{\"a\":[}]"};
+    for (cs* text : invalid) {
+        test_reader("test21.json", text, [] (JSON* json) {
+            assert(json_reader_consume_value(json) == JsonError_invalid);
+        });
+    }
+}
+
+
+static sz
+reference_index(cs* data, sz size, JsonIndexEntry* entries) {
+    sz n = 0;
+    sz stack[64];
+    sz depth = 0;
+    int in_string = 0;
+    for (sz i = 0; i < size; ++i) {
+        char c = data[i];
+        if (in_string) {
+            if (c == '\\') { ++i; }
+            else if (c == '"') { in_string = 0; }
+            continue;
+        }
+        if (c == '"') {
+            in_string = 1;
+        }
+        else if (strchr("[]{}:,", c) == nullptr || c == '\0') {
+            continue;
+        }
+        entries[n]._offset = (u32) i;
+        entries[n]._close = 0;
+        if (c == '[' || c == '{') {
+            stack[depth++] = n;
+        }
+        else if ((c == ']' || c == '}') && depth != 0) {
+            entries[stack[--depth]]._close = (u32) n;
+        }
+        n++;
+    }
+    return n;
+}
+
+
+static void
+test22_structural_index() {
+    cs* data = R"(
+    [{"nested": [[1, 2, [3, {"deep": [[[[[[[[]]]]]]]]}]], {"a": {"b": {"c": {}}}}],
+      "brackets in strings": "[[[{{{\"]]]}}}\\", "more": "}]"},
+     "string with \"escaped\" quotes and a ] bracket",
+     -12.5e+3, true, false, null, [], {},
+     [{"x": "0123456789abcdef0123456789abcdef"}, {"y": ["0123456789abcdef", "]]]]]]]]]]]]]]]]"]}],
+     42]
+    )";
+    char doc[4096];
+    sz size = 0;
+    for (int run = 0; run < 70; ++run) {
+        size += sprintf(doc + size, "{\"k%d\":\"", run);
+        for (int i = 0; i < run; ++i) { doc[size++] = '\\'; }
+        size += sprintf(doc + size, "%s\"},", run % 2 ? "\"[" : "]");
+    }
+    doc[size] = '\0';
+    cs* docs[] = {data, doc, "", "[]", "\"\\\\\"", "{\"a\":[1,2,{\"b\":\"}\"}]}"};
+    for (cs* text : docs) {
+        sz length = strlen(text);
+        JsonIndexEntry expected[2048];
+        JsonIndexEntry entries[2048];
+        sz nexpected = reference_index(text, length, expected);
+        JSON json;
+        assert(json_reader_init_buffer(&json, text, length) == JsonError_ok);
+        sz count = sizeof(entries) / sizeof(entries[0]);
+        assert(json_reader_build_index(&json, entries, &count) == JsonError_ok);
+        assert(count == nexpected);
+        assert(memcmp(entries, expected, count * sizeof(JsonIndexEntry)) == 0);
+        if (count > 0) {
+            sz small = count - 1;
+            assert(json_reader_init_buffer(&json, text, length) == JsonError_ok);
+            assert(json_reader_build_index(&json, entries, &small) == JsonError_bufsize);
+            assert(small == count);
+        }
+    }
+
+    auto worker = [] (JSON* json) {
+        JSON array;
+        JsonValueType type;
+        JsonError err = json_reader_open_array(json, &array);
+        assert(err == JsonError_ok);
+        for (int i = 0; i < 9; ++i) {
+            err = json_reader_read_array(&array, &type);
+            assert(err == JsonError_ok);
+            err = json_reader_skip_value(&array);
+            assert(err == JsonError_ok);
+        }
+        err = json_reader_read_array(&array, &type);
+        assert(err == JsonError_ok);
+        int x;
+        err = json_reader_read_numberi(&array, &x);
+        assert(err == JsonError_ok);
+        assert(x == 42);
+        err = json_reader_read_array(&array, &type);
+        assert(err == JsonError_not_found);
+    };
+    JsonIndexEntry entries[256];
+    sz count = sizeof(entries) / sizeof(entries[0]);
+    JSON json;
+    assert(json_reader_init_buffer(&json, data, strlen(data)) == JsonError_ok);
+    assert(json_reader_build_index(&json, entries, &count) == JsonError_ok);
+    worker(&json);
+
+    cs* filename = "bin/test22.json";
+    write_file(filename, data);
+    count = sizeof(entries) / sizeof(entries[0]);
+    assert(json_reader_init_mmap(&json, filename) == JsonError_ok);
+    assert(json_reader_build_index(&json, entries, &count) == JsonError_ok);
+    worker(&json);
+    assert(json_reader_close(&json) == JsonError_ok);
+    remove(filename);
+
+    cs* truncated = R"([[1, "]", {"a": [)";
+    count = sizeof(entries) / sizeof(entries[0]);
+    assert(json_reader_init_buffer(&json, truncated, strlen(truncated)) == JsonError_ok);
+    assert(json_reader_build_index(&json, entries, &count) == JsonError_ok);
+    assert(json_reader_skip_value(&json) == JsonError_eof);
+    cs* unterminated = R"(["abc)";
+    count = sizeof(entries) / sizeof(entries[0]);
+    assert(json_reader_init_buffer(&json, unterminated, strlen(unterminated)) == JsonError_ok);
+    assert(json_reader_build_index(&json, entries, &count) == JsonError_eof);
+
+    test_file_reader("test22.json", data, [] (JSON* json) {
+        JsonIndexEntry entries[16];
+        sz count = 16;
+        assert(json_reader_build_index(json, entries, &count) == JsonError_invalid);
+    });
+}
+
+
+static void
+test23_document() {
+    cs* data = R"(
+    {"name": "caf\u0041 \"menu\"", "id": 12345678901234, "price": -2.5, "tags": ["a", "b", []],
+     "items": [{"id": 1, "ok": true}, {"id": 2, "ok": false}, {"id": 3, "ok": null}],
+     "empty": {}, "big": 1e300, "exp": 3e2}
+    )";
+    auto check = [] (const JsonNode* root) {
+        assert(json_node_type(root) == JsonValueType_object);
+        assert(json_node_size(root) == 8);
+
+        cs* s;
+        sz n;
+        const JsonNode* name = json_node_child(root);
+        assert(strcmp(json_node_key(name, &n), "name") == 0 && n == 4);
+        assert(json_node_string(name, &s, &n) == JsonError_ok);
+        assert(n == 11 && strcmp(s, "cafA \"menu\"") == 0);
+
+        long long x;
+        double d;
+        const JsonNode* id = json_node_next(name);
+        assert(json_node_numberll(id, &x) == JsonError_ok && x == 12345678901234ll);
+        assert(json_node_numberll(json_node_find(root, "price"), &x) == JsonError_ok && x == -2);
+        assert(json_node_numberd(json_node_find(root, "price"), &d) == JsonError_ok && d == -2.5);
+        assert(json_node_numberll(json_node_find(root, "big"), &x) == JsonError_range);
+        assert(json_node_numberll(json_node_find(root, "exp"), &x) == JsonError_ok && x == 300);
+        assert(json_node_string(id, &s, &n) == JsonError_type_mismatch);
+
+        const JsonNode* tags = json_node_find(root, "tags");
+        assert(json_node_type(tags) == JsonValueType_array && json_node_size(tags) == 3);
+        const JsonNode* tag = json_node_child(tags);
+        assert(json_node_key(tag, nullptr) == nullptr);
+        tag = json_node_next(json_node_next(tag));
+        assert(json_node_type(tag) == JsonValueType_array && json_node_child(tag) == nullptr);
+        assert(json_node_next(tag) == nullptr);
+
+        const JsonNode* items = json_node_find(root, "items");
+        int count = 0;
+        cs* interned = nullptr;
+        for (const JsonNode* item = json_node_child(items); item != nullptr; item = json_node_next(item)) {
+            const JsonNode* item_id = json_node_find(item, "id");
+            assert(json_node_numberll(item_id, &x) == JsonError_ok && x == ++count);
+            cs* key = json_node_key(item_id, nullptr);
+            assert(interned == nullptr || key == interned);
+            interned = key;
+            int b;
+            JsonError err = json_node_bool(json_node_find(item, "ok"), &b);
+            assert(count == 3 ? err == JsonError_null : err == JsonError_ok && b == (count == 1));
+        }
+        assert(count == 3);
+        assert(json_node_key(id, nullptr) == interned);
+
+        const JsonNode* empty = json_node_find(root, "empty");
+        assert(json_node_type(empty) == JsonValueType_object && json_node_size(empty) == 0);
+        assert(json_node_find(root, "missing") == nullptr);
+        assert(json_node_next(json_node_find(root, "exp")) == nullptr);
+    };
+    test_reader("test23.json", data, [data, check] (JSON* json) {
+        static char arena[16384];
+        JsonDocument doc;
+        const JsonNode* root;
+        assert(json_document_init(&doc, arena, sizeof(arena)) == JsonError_ok);
+        assert(json_document_parse(&doc, json, &root) == JsonError_ok);
+        check(root);
+        assert(json_document_used(&doc) > 0);
+
+        json_document_reset(&doc);
+        assert(json_document_used(&doc) == 0);
+        JSON reader;
+        assert(json_reader_init_buffer(&reader, data, strlen(data)) == JsonError_ok);
+        assert(json_document_parse(&doc, &reader, &root) == JsonError_ok);
+        check(root);
+    });
+
+    /* keys must be copied before the window is refilled */
+    cs* keys = R"({"abc":1,"de":2})";
+    for (sz step = 1; step <= 16; ++step) {
+        ChunkedSource source = { keys, strlen(keys), step };
+        JSON json;
+        char arena[2048];
+        JsonDocument doc;
+        const JsonNode* root;
+        assert(json_reader_init_source(&json, chunked_source_read, &source) == JsonError_ok);
+        assert(json_document_init(&doc, arena, sizeof(arena)) == JsonError_ok);
+        assert(json_document_parse(&doc, &json, &root) == JsonError_ok);
+        sz n;
+        long long x;
+        const JsonNode* node = json_node_child(root);
+        assert(strcmp(json_node_key(node, &n), "abc") == 0 && n == 3);
+        assert(json_node_numberll(node, &x) == JsonError_ok && x == 1);
+        node = json_node_next(node);
+        assert(strcmp(json_node_key(node, &n), "de") == 0 && n == 2);
+        assert(json_node_numberll(node, &x) == JsonError_ok && x == 2);
+        assert(json_node_find(root, "de") == node);
+    }
+
+    test_reader("test23.json", "[1, \"two\"] 3 ", [] (JSON* json) {
+        char arena[2048];
+        JsonDocument doc;
+        const JsonNode *first, *second;
+        assert(json_document_init(&doc, arena, sizeof(arena)) == JsonError_ok);
+        assert(json_document_parse(&doc, json, &first) == JsonError_ok);
+        assert(json_document_parse(&doc, json, &second) == JsonError_ok);
+        long long x;
+        assert(json_node_numberll(second, &x) == JsonError_ok && x == 3);
+        assert(json_node_size(first) == 2);
+        assert(json_document_parse(&doc, json, &second) == JsonError_eof);
+    });
+
+    char small[200];
+    JsonDocument doc;
+    const JsonNode* root;
+    JSON json;
+    assert(json_document_init(&doc, small, 64) == JsonError_bufsize);
+    assert(json_document_init(&doc, small, sizeof(small)) == JsonError_ok);
+    assert(json_reader_init_buffer(&json, data, strlen(data)) == JsonError_ok);
+    assert(json_document_parse(&doc, &json, &root) == JsonError_bufsize);
+
+    static char arena[1 << 16];
+    char* nested = nested_document(PAIV_JSON_MAX_DEPTH + 1, 1);
+    assert(json_document_init(&doc, arena, sizeof(arena)) == JsonError_ok);
+    assert(json_reader_init_buffer(&json, nested, strlen(nested)) == JsonError_ok);
+    assert(json_document_parse(&doc, &json, &root) == JsonError_depth);
+    free(nested);
+    cs* invalid[] = {"[1,]", "{\"a\" 1}", "[1 2]", "{\"a\":[}]", "[\"abc"};
+    for (cs* text : invalid) {
+        json_document_reset(&doc);
+        assert(json_reader_init_buffer(&json, text, strlen(text)) == JsonError_ok);
+        assert(json_document_parse(&doc, &json, &root) != JsonError_ok);
+    }
+}
+
+
+static void
+test24_document_writer() {
+    cs* data = R"(
+    {"name": "a\tb \"c\"", "id": 12345678901234, "price": -2.5, "tags": ["a", [], {}],
+     "items": [{"id": 1, "ok": true}, {"ok": false, "x": null}], "big": 1e300}
+    )";
+    cs* compact = R"({"name":"a\tb \"c\"","id":12345678901234,"price":-2.5,"tags":["a",[],{}],)"
+        R"("items":[{"id":1,"ok":true},{"ok":false,"x":null}],"big":1e+300})";
+    cs* indented = "{\n"
+        "  \"name\": \"a\\tb \\\"c\\\"\",\n"
+        "  \"id\": 12345678901234,\n"
+        "  \"price\": -2.5,\n"
+        "  \"tags\": [\n    \"a\",\n    [],\n    {}\n  ],\n"
+        "  \"items\": [\n"
+        "    {\n      \"id\": 1,\n      \"ok\": true\n    },\n"
+        "    {\n      \"ok\": false,\n      \"x\": null\n    }\n"
+        "  ],\n"
+        "  \"big\": 1e+300\n"
+        "}";
+    static char arena[16384];
+    JsonDocument doc;
+    const JsonNode* root;
+    JSON reader;
+    assert(json_document_init(&doc, arena, sizeof(arena)) == JsonError_ok);
+    assert(json_reader_init_buffer(&reader, data, strlen(data)) == JsonError_ok);
+    assert(json_document_parse(&doc, &reader, &root) == JsonError_ok);
+
+    char buf[1024];
+    JSON json;
+    assert(json_writer_init_buffer(&json, buf, sizeof(buf), nullptr, nullptr) == JsonError_ok);
+    assert(json_writer_write_node(&json, root, 0) == JsonError_ok);
+    sz n = json_writer_buffer_size(&json);
+    assert(n == strlen(compact) && memcmp(buf, compact, n) == 0);
+
+    char small[8];
+    OutputSink sink = {};
+    assert(json_writer_init_buffer(&json, small, sizeof(small), output_sink_flush, &sink) == JsonError_ok);
+    assert(json_writer_write_node(&json, root, 2) == JsonError_ok);
+    assert(json_writer_close(&json) == JsonError_ok);
+    assert(sink.size == strlen(indented) && memcmp(sink.data, indented, sink.size) == 0);
+
+    const JsonNode* items = json_node_find(root, "items");
+    assert(json_writer_init_buffer(&json, buf, sizeof(buf), nullptr, nullptr) == JsonError_ok);
+    assert(json_writer_write_node(&json, json_node_child(items), 0) == JsonError_ok);
+    cs* member = R"({"id":1,"ok":true})";
+    n = json_writer_buffer_size(&json);
+    assert(n == strlen(member) && memcmp(buf, member, n) == 0);
+
+    json_document_reset(&doc);
+    assert(json_reader_init_buffer(&reader, sink.data, sink.size) == JsonError_ok);
+    assert(json_document_parse(&doc, &reader, &root) == JsonError_ok);
+    assert(json_writer_init_buffer(&json, buf, sizeof(buf), nullptr, nullptr) == JsonError_ok);
+    assert(json_writer_write_node(&json, root, 0) == JsonError_ok);
+    n = json_writer_buffer_size(&json);
+    assert(n == strlen(compact) && memcmp(buf, compact, n) == 0);
+
+    assert(json_writer_init_buffer(&json, small, sizeof(small), nullptr, nullptr) == JsonError_ok);
+    assert(json_writer_write_node(&json, root, 0) == JsonError_write);
+}
+
+
+static void
+test25_seek_pointer() {
+    cs* data = R"(
+    {"menu": {"header": "SVG Viewer", "skip": [[1, {"items": 0}], "]"],
+              "items": [{"id": "Open"}, {"id": "OpenNew", "label": "Open New"}, null,
+                        {"id": "ZoomIn", "label": "Zoom In"}, 7]},
+     "a/b": 1, "m~n": 2, "": 3, "0": [4, 5]}
+    )";
+    struct { cs* pointer; JsonError err; cs* text; long long number; } samples[] = {
+        {"/menu/header", JsonError_ok, "SVG Viewer", 0},
+        {"/menu/items/3/label", JsonError_ok, "Zoom In", 0},
+        {"/menu/items/1/label", JsonError_ok, "Open New", 0},
+        {"/menu/items/4", JsonError_ok, nullptr, 7},
+        {"/a~1b", JsonError_ok, nullptr, 1},
+        {"/m~0n", JsonError_ok, nullptr, 2},
+        {"/", JsonError_ok, nullptr, 3},
+        {"/0/1", JsonError_ok, nullptr, 5},
+        {"/menu/items/5", JsonError_not_found, nullptr, 0},
+        {"/menu/items/-", JsonError_not_found, nullptr, 0},
+        {"/menu/items/01", JsonError_not_found, nullptr, 0},
+        {"/menu/footer", JsonError_not_found, nullptr, 0},
+        {"/menu/header/x", JsonError_type_mismatch, nullptr, 0},
+        {"/menu/items/0/id/0", JsonError_type_mismatch, nullptr, 0},
+        {"menu", JsonError_invalid, nullptr, 0},
+        {"/m~2n", JsonError_invalid, nullptr, 0},
+    };
+    for (auto& t : samples) {
+        test_reader("test25.json", data, [&t] (JSON* json) {
+            assert(json_reader_seek_pointer(json, t.pointer) == t.err);
+            if (t.err != JsonError_ok) { return; }
+            if (t.text != nullptr) {
+                char buf[32];
+                sz n = sizeof(buf);
+                assert(json_reader_read_string(json, &n, buf) == JsonError_ok);
+                assert(strcmp(buf, t.text) == 0);
+            }
+            else {
+                long long x;
+                assert(json_reader_read_numberll(json, &x) == JsonError_ok);
+                assert(x == t.number);
+            }
+        });
+    }
+
+    test_reader("test25.json", data, [] (JSON* json) {
+        JsonValueType type;
+        assert(json_reader_seek_pointer(json, "") == JsonError_ok);
+        assert(json_reader_peek_value(json, &type) == JsonError_ok);
+        assert(type == JsonValueType_object);
+        assert(json_reader_seek_pointer(json, "/menu/items/2") == JsonError_ok);
+        assert(json_reader_read_null(json) == JsonError_ok);
+    });
+
+    char long_key[300];
+    long_key[0] = '/';
+    memset(long_key + 1, 'k', sizeof(long_key) - 2);
+    long_key[sizeof(long_key) - 1] = '\0';
+    test_reader("test25.json", data, [&long_key] (JSON* json) {
+        assert(json_reader_seek_pointer(json, long_key) == JsonError_bufsize);
+    });
+}
+
+
+typedef struct {
+    char values[8][32];
+    int calls;
+} ProjectionResult;
+
+
+static JsonError
+projection_collect(void* user_data, int path, JSON* json) {
+    ProjectionResult* result = (ProjectionResult*) user_data;
+    result->calls++;
+    JsonValueType type;
+    JsonError err = json_reader_peek_value(json, &type);
+    if (err != JsonError_ok) { return err; }
+    char* out = result->values[path];
+    switch (type) {
+        case JsonValueType_string: {
+            sz n = sizeof(result->values[0]);
+            return json_reader_read_string(json, &n, out);
+        }
+        case JsonValueType_number: {
+            long long x;
+            err = json_reader_read_numberll(json, &x);
+            snprintf(out, sizeof(result->values[0]), "%lld", x);
+            return err;
+        }
+        default:
+            snprintf(out, sizeof(result->values[0]), "type %d", type);
+            return json_reader_skip_value(json);
+    }
+}
+
+
+static void
+test26_projection() {
+    cs* data = R"(
+    {"menu": {"header": "SVG Viewer", "skip": [[1, {"items": 0}], "]"],
+              "items": [{"id": "Open"}, {"id": "OpenNew", "label": "Open New"}, null,
+                        {"id": "ZoomIn", "label": "Zoom In"}, 7]},
+     "a/b": 1, "m~n": 2, "": 3, "0": [4, 5]}
+    42
+    )";
+    cs* pointers[] = {
+        "/menu/items/3/label", "/menu/header", "/a~1b", "/0/1",
+        "/menu/items/1/id", "/menu/items/9", "/menu/items/x", "/menu/skip",
+    };
+    cs* expect[] = {"Zoom In", "SVG Viewer", "1", "5", "OpenNew", "", "", "type 1"};
+    const int count = sizeof(pointers) / sizeof(pointers[0]);
+    static char storage[4096];
+    sz size = json_projection_storage_size(pointers, count);
+    assert(size <= sizeof(storage));
+    JsonProjection projection;
+    assert(json_projection_init(&projection, pointers, count, storage, size - 1) == JsonError_bufsize);
+    assert(json_projection_init(&projection, pointers, count, storage, size) == JsonError_ok);
+    test_reader("test26.json", data, [&projection, &expect] (JSON* json) {
+        ProjectionResult result = {};
+        assert(json_reader_project(json, &projection, projection_collect, &result) == JsonError_ok);
+        assert(result.calls == 6);
+        for (int i = 0; i < count; ++i) {
+            assert(strcmp(result.values[i], expect[i]) == 0);
+        }
+        int x;
+        assert(json_reader_read_numberi(json, &x) == JsonError_ok);
+        assert(x == 42);
+    });
+
+    /* the rest of a container is skipped from inside it */
+    JsonIndexEntry entries[256];
+    sz entry_count = sizeof(entries) / sizeof(entries[0]);
+    JSON indexed;
+    assert(json_reader_init_buffer(&indexed, data, strlen(data)) == JsonError_ok);
+    assert(json_reader_build_index(&indexed, entries, &entry_count) == JsonError_ok);
+    ProjectionResult indexed_result = {};
+    assert(json_reader_project(&indexed, &projection, projection_collect, &indexed_result) == JsonError_ok);
+    assert(indexed_result.calls == 6);
+    for (int i = 0; i < count; ++i) {
+        assert(strcmp(indexed_result.values[i], expect[i]) == 0);
+    }
+    int x;
+    assert(json_reader_read_numberi(&indexed, &x) == JsonError_ok && x == 42);
+
+    cs* root[] = {""};
+    assert(json_projection_init(&projection, root, 1, storage, sizeof(storage)) == JsonError_ok);
+    test_reader("test26.json", "[1, 2] 3", [&projection] (JSON* json) {
+        ProjectionResult result = {};
+        assert(json_reader_project(json, &projection, projection_collect, &result) == JsonError_ok);
+        assert(result.calls == 1 && strcmp(result.values[0], "type 1") == 0);
+        assert(json_reader_project(json, &projection, projection_collect, &result) == JsonError_ok);
+        assert(result.calls == 2 && strcmp(result.values[0], "3") == 0);
+    });
+
+    cs* prefix[] = {"/a", "/a/b"};
+    cs* duplicate[] = {"/a", "/b", "/a"};
+    cs* invalid[] = {"/a", "b"};
+    assert(json_projection_init(&projection, prefix, 2, storage, sizeof(storage)) == JsonError_invalid);
+    assert(json_projection_init(&projection, duplicate, 3, storage, sizeof(storage)) == JsonError_invalid);
+    assert(json_projection_init(&projection, invalid, 2, storage, sizeof(storage)) == JsonError_invalid);
+
+    cs* truncated = R"({"a": {"b": [1, )";
+    cs* paths[] = {"/a/b/1", "/z"};
+    assert(json_projection_init(&projection, paths, 2, storage, sizeof(storage)) == JsonError_ok);
+    test_reader("test26.json", truncated, [&projection] (JSON* json) {
+        ProjectionResult result = {};
+        assert(json_reader_project(json, &projection, projection_collect, &result) == JsonError_eof);
+    });
+}
+
+
+static void
+test27_records() {
+    cs* data = "{\"a\": 1}\n"
+        "\n"
+        "  [1, 2]  \r\n"
+        "{\"bad\": }\n"
+        "\"str\"\n"
+        "{\"a\": 2} trailing\n"
+        "42";
+    auto worker = [data] (JSON* json) {
+        JsonRecord record;
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == 0 && record.line == 1);
+        assert(json_reader_consume_value(json) == JsonError_ok);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == (sz) (strstr(data, "[1, 2]") - data) && record.line == 3);
+        assert(json_reader_consume_value(json) == JsonError_ok);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == (sz) (strstr(data, "{\"bad") - data) && record.line == 4);
+        assert(json_reader_consume_value(json) == JsonError_invalid);
+        assert(json_reader_skip_record(json) == JsonError_ok);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == (sz) (strstr(data, "\"str") - data) && record.line == 5);
+        char buf[8];
+        sz n = sizeof(buf);
+        assert(json_reader_read_string(json, &n, buf) == JsonError_ok);
+        assert(strcmp(buf, "str") == 0);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.line == 6);
+        assert(json_reader_consume_value(json) == JsonError_ok);
+        assert(json_reader_next_record(json, &record) == JsonError_invalid);
+        assert(json_reader_skip_record(json) == JsonError_ok);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == strlen(data) - 2 && record.line == 7);
+        int x;
+        assert(json_reader_read_numberi(json, &x) == JsonError_ok);
+        assert(x == 42);
+        assert(json_reader_next_record(json, &record) == JsonError_eof);
+    };
+    test_reader("test27.json", data, worker);
+
+    cs* filename = "bin/test27.json";
+    write_file(filename, data);
+    JSON json;
+    assert(json_reader_init_mmap(&json, filename) == JsonError_ok);
+    worker(&json);
+    assert(json_reader_close(&json) == JsonError_ok);
+    remove(filename);
+
+    test_reader("test27.json", "\n \n", [] (JSON* json) {
+        JsonRecord record;
+        assert(json_reader_next_record(json, &record) == JsonError_eof);
+    });
+    test_reader("test27.json", "[1, \"]\n", [] (JSON* json) {
+        JsonRecord record;
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(json_reader_consume_value(json) != JsonError_ok);
+        assert(json_reader_skip_record(json) == JsonError_ok);
+        assert(json_reader_next_record(json, &record) == JsonError_eof);
+    });
+    cs* open_string = "{\"a\":\"abc\n{\"b\":1}\n{\"c\":2}\n";
+    test_reader("test27.json", open_string, [open_string] (JSON* json) {
+        JsonRecord record;
+        JSON object;
+        JsonValueType type;
+        char key[4];
+        sz n = sizeof(key);
+        int x;
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(json_reader_consume_value(json) == JsonError_invalid);
+        assert(json_reader_skip_record(json) == JsonError_ok);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == (sz) (strstr(open_string, "{\"b") - open_string) && record.line == 2);
+        assert(json_reader_open_object(json, &object) == JsonError_ok);
+        assert(json_reader_read_object(&object, &n, key, &type) == JsonError_ok && strcmp(key, "b") == 0);
+        assert(json_reader_read_numberi(&object, &x) == JsonError_ok && x == 1);
+        assert(json_reader_read_object(&object, &n, key, &type) == JsonError_not_found);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == (sz) (strstr(open_string, "{\"c") - open_string) && record.line == 3);
+        assert(json_reader_consume_value(json) == JsonError_ok);
+        assert(json_reader_next_record(json, &record) == JsonError_eof);
+    });
+    /* the failed record read the opening bracket of the next one */
+    cs* unclosed = "{\"a\":1\n{\"b\":2}\n{\"c\":3}\n";
+    auto unclosed_worker = [unclosed] (JSON* json) {
+        JsonRecord record;
+        JSON object;
+        JsonValueType type;
+        char key[4];
+        sz n = sizeof(key);
+        int x;
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(json_reader_consume_value(json) == JsonError_invalid);
+        assert(json_reader_skip_record(json) == JsonError_ok);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == (sz) (strstr(unclosed, "{\"b") - unclosed) && record.line == 2);
+        assert(json_reader_open_object(json, &object) == JsonError_ok);
+        assert(json_reader_read_object(&object, &n, key, &type) == JsonError_ok && strcmp(key, "b") == 0);
+        assert(json_reader_read_numberi(&object, &x) == JsonError_ok && x == 2);
+        assert(json_reader_read_object(&object, &n, key, &type) == JsonError_not_found);
+
+        assert(json_reader_next_record(json, &record) == JsonError_ok);
+        assert(record.offset == (sz) (strstr(unclosed, "{\"c") - unclosed) && record.line == 3);
+        assert(json_reader_consume_value(json) == JsonError_ok);
+        assert(json_reader_next_record(json, &record) == JsonError_eof);
+    };
+    test_reader("test27.json", unclosed, unclosed_worker);
+    write_file(filename, unclosed);
+    assert(json_reader_init_mmap(&json, filename) == JsonError_ok);
+    unclosed_worker(&json);
+    assert(json_reader_close(&json) == JsonError_ok);
+    remove(filename);
+
+    /* the failed record spans lines that a small source window has
+       already moved past */
+    cs* spanning = "{\"a\":\n1,]\n{\"b\":2}\n{\"c\":3}\n";
+    test_reader("test27.json", spanning, [spanning] (JSON* json) {
+        JsonRecord record;
+        int found = 0;
+        for (;;) {
+            JsonError err = json_reader_next_record(json, &record);
+            if (err == JsonError_eof) { break; }
+            if (err == JsonError_ok) {
+                err = json_reader_consume_value(json);
+            }
+            if (err != JsonError_ok) {
+                assert(json_reader_skip_record(json) == JsonError_ok);
+                continue;
+            }
+            if (record.offset == (sz) (strstr(spanning, "{\"b") - spanning)) {
+                assert(record.line == 3);
+                found |= 1;
+            }
+            if (record.offset == (sz) (strstr(spanning, "{\"c") - spanning)) {
+                assert(record.line == 4);
+                found |= 2;
+            }
+        }
+        assert(found == 3);
+    });
+
+    /* a FILE that cannot seek back reports the failed resync */
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(write(fds[1], unclosed, strlen(unclosed)) == (ssize_t) strlen(unclosed));
+    close(fds[1]);
+    FILE* fp = fdopen(fds[0], "r");
+    assert(fp != nullptr);
+    assert(json_reader_init(&json, fp) == JsonError_ok);
+    JsonRecord record;
+    assert(json_reader_next_record(&json, &record) == JsonError_ok);
+    assert(json_reader_consume_value(&json) == JsonError_invalid);
+    assert(json_reader_skip_record(&json) == JsonError_read);
+    fclose(fp);
+}
+
+
+typedef struct {
+    cs* data;
+    long long sums[8];
+    int failures[8];
+    sz chunks;
+    sz records;
+    int ordered;
+} ParallelResult;
+
+
+static JsonError
+parallel_record(void* user_data, int worker, JSON* json, const JsonRecord* record) {
+    ParallelResult* result = (ParallelResult*) user_data;
+    assert(worker >= 0 && worker < 8);
+    assert(record->line >= 1);
+    JSON object;
+    JsonValueType type;
+    char key[8];
+    sz n = sizeof(key);
+    int id;
+    if (json_reader_open_object(json, &object) != JsonError_ok ||
+        json_reader_read_object(&object, &n, key, &type) != JsonError_ok ||
+        json_reader_read_numberi(&object, &id) != JsonError_ok) {
+        result->failures[worker]++;
+        return json_reader_skip_record(json);
+    }
+    for (n = sizeof(key); json_reader_read_object(&object, &n, key, &type) == JsonError_ok; n = sizeof(key)) {
+        assert(json_reader_consume_value(&object) == JsonError_ok);
+    }
+    assert(result->data[record->offset] == '{');
+    if (id == -1) {
+        return JsonError_range;
+    }
+    result->sums[worker] += id;
+    return JsonError_ok;
+}
+
+
+static JsonError
+parallel_commit(void* user_data, int worker, const JsonChunk* chunk) {
+    ParallelResult* result = (ParallelResult*) user_data;
+    if (result->ordered) {
+        assert(chunk->index == result->chunks);
+        sz line = 1;
+        for (sz i = 0; i < chunk->offset; ++i) {
+            line += result->data[i] == '\n';
+        }
+        assert(chunk->line == line);
+    }
+    result->chunks++;
+    result->records += chunk->records;
+    return JsonError_ok;
+}
+
+
+static void
+test28_parallel_records() {
+    const int count = 3000;
+    static char data[count * 40];
+    sz size = 0;
+    long long expect = 0;
+    for (int i = 0; i < count; ++i) {
+        if (i % 100 == 7) {
+            size += sprintf(data + size, "{\"id\": }\n\n");
+            continue;
+        }
+        size += sprintf(data + size, "{\"id\": %d, \"s\": \"x\\n\"}\n", i);
+        expect += i;
+    }
+    data[size] = '\0';
+
+    for (int ordered = 0; ordered < 2; ++ordered) {
+        ParallelResult result = {};
+        result.data = data;
+        result.ordered = ordered;
+        JsonParallel parallel = {};
+        parallel.record = parallel_record;
+        parallel.commit = parallel_commit;
+        parallel.user_data = &result;
+        parallel.threads = 4;
+        parallel.ordered = ordered;
+        parallel.chunk_size = 256;
+        JSON json;
+        assert(json_reader_init_buffer(&json, data, size) == JsonError_ok);
+        assert(json_reader_parallel_records(&json, &parallel) == JsonError_ok);
+        long long sum = 0;
+        int failures = 0;
+        for (int i = 0; i < 8; ++i) {
+            sum += result.sums[i];
+            failures += result.failures[i];
+        }
+        assert(sum == expect);
+        assert(failures == count / 100);
+        assert(result.records == (sz) count);
+        assert(result.chunks > 1);
+        JsonRecord record;
+        assert(json_reader_next_record(&json, &record) == JsonError_eof);
+    }
+
+    char* line = strchr(data + size / 2, '\n') + 1;
+    memcpy(line, "{\"id\": -1}", 11);
+    for (char* p = line + 11; *p != '\n'; ++p) { *p = ' '; }
+    ParallelResult result = {};
+    result.data = data;
+    JsonParallel parallel = {};
+    parallel.record = parallel_record;
+    parallel.user_data = &result;
+    parallel.threads = 3;
+    parallel.chunk_size = 100;
+    JSON json;
+    assert(json_reader_init_buffer(&json, data, size) == JsonError_ok);
+    assert(json_reader_parallel_records(&json, &parallel) == JsonError_range);
+
+    cs* trailing = "{\"id\": 1}\n{\"id\": 2} 3\n{\"id\": 4}\n";
+    result.data = trailing;
+    assert(json_reader_init_buffer(&json, trailing, strlen(trailing)) == JsonError_ok);
+    assert(json_reader_parallel_records(&json, &parallel) == JsonError_invalid);
+
+    FILE* fp = fmemopen(data, size, "r");
+    assert(json_reader_init(&json, fp) == JsonError_ok);
+    assert(json_reader_parallel_records(&json, &parallel) == JsonError_invalid);
+    fclose(fp);
+}
+
+
+static JsonError
+array_element(void* user_data, int worker, JSON* json, const JsonRecord* record) {
+    ParallelResult* result = (ParallelResult*) user_data;
+    assert(worker >= 0 && worker < 8);
+    assert(record->line == 0);
+    JSON object;
+    JsonValueType type;
+    char key[8];
+    sz n = sizeof(key);
+    int id;
+    JsonError err = json_reader_open_object(json, &object);
+    if (err != JsonError_ok) { return err; }
+    assert(result->data[record->offset] == '{');
+    err = json_reader_read_object(&object, &n, key, &type);
+    if (err != JsonError_ok) { return err; }
+    err = json_reader_read_numberi(&object, &id);
+    if (err != JsonError_ok) { return err; }
+    for (n = sizeof(key); json_reader_read_object(&object, &n, key, &type) == JsonError_ok; n = sizeof(key)) {
+        assert(json_reader_consume_value(&object) == JsonError_ok);
+    }
+    if (id == -1) {
+        return JsonError_range;
+    }
+    result->sums[worker] += id;
+    return JsonError_ok;
+}
+
+
+static JsonError
+array_commit(void* user_data, int worker, const JsonChunk* chunk) {
+    ParallelResult* result = (ParallelResult*) user_data;
+    if (result->ordered) {
+        assert(chunk->index == result->chunks);
+    }
+    assert(chunk->line == 0);
+    result->chunks++;
+    result->records += chunk->records;
+    return JsonError_ok;
+}
+
+
+static void
+test29_parallel_array() {
+    const int count = 2000;
+    static char data[count * 64];
+    sz size = sprintf(data, " [");
+    long long expect = 0;
+    for (int i = 0; i < count; ++i) {
+        cs* extra = "";
+        switch (i % 4) {
+            case 1: extra = ", \"s\": \"],[{\\\"\""; break;
+            case 2: extra = ", \"a\": [[1, 2], {\"b\": [3]}]"; break;
+            case 3: extra = ", \"s\": \"\\\\\\\\\", \"t\": \",\""; break;
+        }
+        size += sprintf(data + size, "%s\n{\"id\": %d%s}", i == 0 ? "" : ",", i, extra);
+        expect += i;
+    }
+    size += sprintf(data + size, "\n] ");
+
+    sz chunk_sizes[] = {1, 7, 64, 100, 1000, 0};
+    for (sz chunk_size : chunk_sizes) {
+        for (int ordered = 0; ordered < 2; ++ordered) {
+            ParallelResult result = {};
+            result.data = data;
+            result.ordered = ordered;
+            JsonParallel parallel = {};
+            parallel.record = array_element;
+            parallel.commit = array_commit;
+            parallel.user_data = &result;
+            parallel.threads = 4;
+            parallel.ordered = ordered;
+            parallel.chunk_size = chunk_size;
+            JSON json;
+            assert(json_reader_init_buffer(&json, data, size) == JsonError_ok);
+            assert(json_reader_parallel_array(&json, &parallel) == JsonError_ok);
+            long long sum = 0;
+            for (int i = 0; i < 8; ++i) {
+                sum += result.sums[i];
+            }
+            assert(sum == expect);
+            assert(result.records == (sz) count);
+            assert(result.chunks >= 1);
+            assert(chunk_size == 0 || result.chunks > 1);
+            JsonValueType type;
+            assert(json_reader_peek_value(&json, &type) == JsonError_eof);
+        }
+    }
+
+    auto check = [] (cs* text, JsonError expect, sz records) {
+        ParallelResult result = {};
+        result.data = text;
+        JsonParallel parallel = {};
+        parallel.record = array_element;
+        parallel.commit = array_commit;
+        parallel.user_data = &result;
+        parallel.threads = 2;
+        parallel.chunk_size = 4;
+        JSON json;
+        assert(json_reader_init_buffer(&json, text, strlen(text)) == JsonError_ok);
+        assert(json_reader_parallel_array(&json, &parallel) == expect);
+        assert(records == (sz) -1 || result.records == records);
+    };
+    check("[]", JsonError_ok, 0);
+    check("[ {\"id\": 1} ] 2", JsonError_ok, 1);
+    check("[{\"id\": 1}, ]", JsonError_invalid, -1);
+    check("[{\"id\": 1},, {\"id\": 2}]", JsonError_invalid, -1);
+    check("[{\"id\": 1}, {\"id\": 2}", JsonError_eof, 0);
+    check("[{\"id\": \"]}", JsonError_eof, 0);
+    check("[{\"id\": 1}, 2]", JsonError_type_mismatch, -1);
+    check("[{\"id\": 1}, {\"id\": -1}]", JsonError_range, -1);
+    check("{\"id\": 1}", JsonError_type_mismatch, 0);
+    check("null", JsonError_null, 0);
+
+    ParallelResult result = {};
+    result.data = data;
+    JsonParallel parallel = {};
+    parallel.record = array_element;
+    parallel.user_data = &result;
+    JSON json;
+    FILE* fp = fmemopen(data, size, "r");
+    assert(json_reader_init(&json, fp) == JsonError_ok);
+    assert(json_reader_parallel_array(&json, &parallel) == JsonError_invalid);
+    fclose(fp);
+}
+
+
+typedef struct {
+    int fd;
+    cs* data;
+    sz size;
+    useconds_t delay;
+} PipeWriter;
+
+
+static void*
+pipe_writer(void* arg) {
+    PipeWriter* writer = (PipeWriter*) arg;
+    for (sz i = 0; i < writer->size; i += 1000) {
+        sz n = writer->size - i < 1000 ? writer->size - i : 1000;
+        if (write(writer->fd, writer->data + i, n) != (ssize_t) n) {
+            break;
+        }
+        usleep(writer->delay);
+    }
+    close(writer->fd);
+    return nullptr;
+}
+
+
+static void
+test30_pipe() {
+    const int count = 5000;
+    static char data[count * 40];
+    sz size = sprintf(data, "[");
+    long long expect = 0;
+    for (int i = 0; i < count; ++i) {
+        size += sprintf(data + size, "%s{\"id\": %d, \"s\": \"x\"}", i == 0 ? "" : ",\n", i);
+        expect += i;
+    }
+    size += sprintf(data + size, "]");
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    PipeWriter writer = { fds[1], data, size };
+    pthread_t thread;
+    assert(pthread_create(&thread, nullptr, pipe_writer, &writer) == 0);
+    FILE* fp = fdopen(fds[0], "r");
+    assert(fp != nullptr);
+
+    static char storage[4096];
+    JSON json;
+    JSON array;
+    assert(json_reader_init_pipe(&json, fp, 512, storage, sizeof(storage)) == JsonError_ok);
+    assert(json_reader_open_array(&json, &array) == JsonError_ok);
+    long long sum = 0;
+    while (json_reader_read_array(&array, nullptr) == JsonError_ok) {
+        JSON object;
+        JsonValueType type;
+        char key[8];
+        sz n = sizeof(key);
+        int id;
+        assert(json_reader_open_object(&array, &object) == JsonError_ok);
+        assert(json_reader_read_object(&object, &n, key, &type) == JsonError_ok);
+        assert(json_reader_read_numberi(&object, &id) == JsonError_ok);
+        for (n = sizeof(key); json_reader_read_object(&object, &n, key, &type) == JsonError_ok; n = sizeof(key)) {
+            assert(json_reader_consume_value(&object) == JsonError_ok);
+        }
+        sum += id;
+    }
+    assert(sum == expect);
+    assert(json_reader_peek_value(&json, nullptr) == JsonError_eof);
+    assert(json_reader_close(&json) == JsonError_ok);
+    pthread_join(thread, nullptr);
+    fclose(fp);
+
+    /* stopping early while the ring is full */
+    cs* filename = "bin/test30.json";
+    write_file(filename, data);
+    fp = fopen(filename, "r");
+    assert(fp != nullptr);
+    assert(json_reader_init_pipe(&json, fp, 64, storage, json_reader_pipe_storage_size(64, 3)) == JsonError_ok);
+    assert(json_reader_open_array(&json, &array) == JsonError_ok);
+    assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+    assert(json_reader_consume_value(&array) == JsonError_ok);
+    usleep(1000);
+    assert(json_reader_close(&json) == JsonError_ok);
+    assert(json_reader_close(&json) == JsonError_ok);
+
+    assert(json_reader_init_pipe(&json, fp, 64, storage, json_reader_pipe_storage_size(64, 1)) == JsonError_bufsize);
+    assert(json_reader_init_pipe(&json, fp, 0, storage, sizeof(storage)) == JsonError_bufsize);
+    fclose(fp);
+
+    /* stopping while the producer waits on a pipe that stays open */
+    assert(pipe(fds) == 0);
+    assert(write(fds[1], "[1,2,3] ", 8) == 8);
+    fp = fdopen(fds[0], "r");
+    assert(fp != nullptr);
+    assert(json_reader_init_pipe(&json, fp, 64, storage, sizeof(storage)) == JsonError_ok);
+    assert(json_reader_open_array(&json, &array) == JsonError_ok);
+    assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+    assert(json_reader_consume_value(&array) == JsonError_ok);
+    usleep(1000);
+    assert(json_reader_close(&json) == JsonError_ok);
+    fclose(fp);
+    close(fds[1]);
+
+    /* a slow source and a slow reader leave the other side asleep */
+    assert(pipe(fds) == 0);
+    PipeWriter slow = { fds[1], data, 4000, 50000 };
+    assert(pthread_create(&thread, nullptr, pipe_writer, &slow) == 0);
+    fp = fdopen(fds[0], "r");
+    assert(fp != nullptr);
+    clock_t start = clock();
+    assert(json_reader_init_pipe(&json, fp, 512, storage, sizeof(storage)) == JsonError_ok);
+    assert(json_reader_consume_value(&json) == JsonError_eof);
+    assert(json_reader_close(&json) == JsonError_ok);
+    assert(clock() - start < CLOCKS_PER_SEC / 20);
+    pthread_join(thread, nullptr);
+    fclose(fp);
+
+    fp = fopen(filename, "r");
+    assert(fp != nullptr);
+    start = clock();
+    assert(json_reader_init_pipe(&json, fp, 64, storage, json_reader_pipe_storage_size(64, 3)) == JsonError_ok);
+    assert(json_reader_open_array(&json, &array) == JsonError_ok);
+    for (int i = 0; i < 10; ++i) {
+        assert(json_reader_read_array(&array, nullptr) == JsonError_ok);
+        assert(json_reader_consume_value(&array) == JsonError_ok);
+        usleep(20000);
+    }
+    assert(json_reader_close(&json) == JsonError_ok);
+    assert(clock() - start < CLOCKS_PER_SEC / 20);
+    fclose(fp);
+
+    JSON failed;
+    memset(&failed, 0xff, sizeof(failed));
+    assert(json_reader_init_pipe(&failed, stdin, 0, storage, sizeof(storage)) == JsonError_bufsize);
+    assert(json_reader_close(&failed) == JsonError_ok);
+
+    fp = fopen("bin", "r");
+    assert(fp != nullptr);
+    assert(json_reader_init_pipe(&json, fp, 64, storage, sizeof(storage)) == JsonError_ok);
+    assert(json_reader_peek_value(&json, nullptr) == JsonError_eof);
+    assert(json_reader_close(&json) == JsonError_read);
+    fclose(fp);
+}
+
+
 int main(int argc, const char* argv[]) {
     test1_hello();
     test2_objects();
@@ -387,6 +2345,26 @@ int main(int argc, const char* argv[]) {
     test8_numbers_i64();
     test9_numbers_double();
     test10_consume_values();
+    test11_mmap();
+    test12_buffer_writer();
+    test13_long_strings();
+    test14_number_conversion();
+    test15_number_formatting();
+    test16_integer_formatting();
+    test17_string_writer();
+    test18_string_views();
+    test19_key_table();
+    test20_skip_value();
+    test21_nesting_depth();
+    test22_structural_index();
+    test23_document();
+    test24_document_writer();
+    test25_seek_pointer();
+    test26_projection();
+    test27_records();
+    test28_parallel_records();
+    test29_parallel_array();
+    test30_pipe();
 
     return 0;
 }